@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/workqueue.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -75,6 +76,9 @@ struct channel
 										 any interrupt would be spurious. */
 	struct semaphore completion_wait; /* Up'd by interrupt handler. */
 
+	unsigned unexpected_cnt;		  /* Spurious interrupts not yet reported. */
+	struct work unexpected_work;	  /* Reports them, see interrupt_handler(). */
+
 	struct disk devices[2]; /* The devices on this channel. */
 };
 
@@ -97,6 +101,7 @@ static void select_device(const struct disk *);
 static void select_device_wait(const struct disk *);
 
 static void interrupt_handler(struct intr_frame *);
+static work_func report_unexpected;
 
 /* Initialize the disk subsystem and detect disks. */
 void disk_init(void)
@@ -126,6 +131,8 @@ void disk_init(void)
 		lock_init(&c->lock);
 		c->expecting_interrupt = false;
 		sema_init(&c->completion_wait, 0);
+		c->unexpected_cnt = 0;
+		work_init(&c->unexpected_work, report_unexpected);
 
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++)
@@ -557,13 +564,39 @@ interrupt_handler(struct intr_frame *f)
 				sema_up(&c->completion_wait); /* Wake up waiter. */
 			}
 			else
-				printf("%s: unexpected interrupt\n", c->name);
+			{
+				/* Printing takes the console lock, so leave it to a
+				   worker thread, which also batches a storm of
+				   spurious interrupts into a single line. */
+				c->unexpected_cnt++;
+				queue_work(&c->unexpected_work);
+			}
 			return;
 		}
 
 	NOT_REACHED();
 }
 
+/* Reports the spurious interrupts counted on a channel since the
+   last report.  Runs from the workqueue. */
+static void
+report_unexpected(struct work *w)
+{
+	struct channel *c = work_entry(w, struct channel, unexpected_work);
+	enum intr_level old_level;
+	unsigned cnt;
+
+	old_level = intr_disable();
+	cnt = c->unexpected_cnt;
+	c->unexpected_cnt = 0;
+	intr_set_level(old_level);
+
+	if (cnt == 1)
+		printf("%s: unexpected interrupt\n", c->name);
+	else if (cnt > 1)
+		printf("%s: %u unexpected interrupts\n", c->name, cnt);
+}
+
 static void
 inspect_read_cnt(struct intr_frame *f)
 {
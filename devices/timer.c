@@ -9,6 +9,7 @@
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -19,55 +20,124 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* 8254 input frequency, in Hz. */
+#define PIT_FREQ 1193180
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Number of loops per timer tick.
-     Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* PIT input clocks per timer tick. */
+static uint16_t pit_count;
+
+/* If true, the idle thread stops the periodic tick while it
+     waits.  Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Number of ticks the PIT was programmed to cover in one-shot
+     mode by timer_idle_enter(), or 0 while ticking periodically. */
+static int64_t oneshot_ticks;
+
+/* Nanosecond clock, read from the CPU's time-stamp counter (TSC).
+
+     timer_calibrate() counts TSC cycles across TSC_CALIBRATE_TICKS
+     timer ticks to find the TSC's frequency.  Cycles are then
+     converted to nanoseconds by multiplying by tsc_mult, which is
+     nanoseconds per cycle scaled by 2**TSC_SHIFT, so that reading
+     the clock takes no division.  Until calibration the clock
+     only advances with `ticks'. */
+#define TSC_CALIBRATE_TICKS 10
+#define TSC_SHIFT 32
+static uint64_t tsc_hz;   /* TSC frequency, or 0 if uncalibrated. */
+static uint64_t tsc_mult; /* Nanoseconds per cycle << TSC_SHIFT. */
+static uint64_t tsc_base; /* TSC at calibration... */
+static int64_t ns_base;   /* ...and timer_ns() at that moment. */
+
+/* Sleeping threads are kept in a hierarchical timing wheel keyed
+     by their absolute wake tick (struct thread's `ticks' member).
+
+     Level L has WHEEL_SLOTS slots, each covering 2**(WHEEL_BITS*L)
+     ticks.  A thread whose wake tick agrees with the current tick
+     in every bit above level L is filed at level L, in the slot
+     selected by the wake tick's level-L bits.  Each tick only the
+     level-0 slot for that tick is examined; whenever the lower
+     bits of `ticks' roll over to zero, the matching slot of the
+     next level up is "cascaded", i.e. its threads are re-filed at
+     a lower level.  Insertion is O(1) and every thread is moved at
+     most WHEEL_LEVELS times before it wakes.
+
+     Threads that would sleep past the reach of the top level wait
+     on wheel_overflow, which is re-examined each time the top
+     level wraps around. */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static struct list wheel_overflow;
+
+static void wheel_insert(struct thread *);
+static void wheel_cascade(struct list *);
+static void wheel_advance(void);
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops(unsigned loops);
-static void busy_wait(int64_t loops);
+static void pit_set_periodic(void);
+static void pit_set_oneshot(uint16_t count);
+static void timer_catch_up(int64_t elapsed);
 static void real_time_sleep(int64_t num, int32_t denom);
 
+/* Returns the time-stamp counter. */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
      interrupt PIT_FREQ times per second, and registers the
      corresponding interrupt. */
 void timer_init(void) {
     /* 8254 input frequency divided by TIMER_FREQ, rounded to
          nearest. */
-    uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+    pit_count = (PIT_FREQ + TIMER_FREQ / 2) / TIMER_FREQ;
+    pit_set_periodic();
 
-    outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
-    outb(0x40, count & 0xff);
-    outb(0x40, count >> 8);
+    for (int level = 0; level < WHEEL_LEVELS; level++)
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++)
+            list_init(&wheel[level][slot]);
+    list_init(&wheel_overflow);
 
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the TSC against the timer interrupt, after which
+     timer_ns() has nanosecond resolution. */
 void timer_calibrate(void) {
-    unsigned high_bit, test_bit;
+    enum intr_level old_level;
+    int64_t start;
+    uint64_t tsc_start, tsc_end;
 
     ASSERT(intr_get_level() == INTR_ON);
     printf("Calibrating timer...  ");
 
-    /* Approximate loops_per_tick as the largest power-of-two
-         still less than one timer tick. */
-    loops_per_tick = 1u << 10;
-    while (!too_many_loops(loops_per_tick << 1)) {
-        loops_per_tick <<= 1;
-        ASSERT(loops_per_tick != 0);
-    }
+    /* Count cycles from one tick to another.  Sampling right at
+         the edges keeps the error to the interrupt latency. */
+    start = ticks;
+    while (ticks == start)
+        barrier();
+    tsc_start = rdtsc();
+    start = ticks;
+    while (ticks - start < TSC_CALIBRATE_TICKS)
+        barrier();
+    tsc_end = rdtsc();
 
-    /* Refine the next 8 bits of loops_per_tick. */
-    high_bit = loops_per_tick;
-    for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-        if (!too_many_loops(high_bit | test_bit))
-            loops_per_tick |= test_bit;
+    old_level = intr_disable();
+    ns_base = timer_ns();
+    tsc_base = rdtsc();
+    tsc_hz = (tsc_end - tsc_start) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+    tsc_mult = ((uint64_t)NSEC_PER_SEC << TSC_SHIFT) / tsc_hz;
+    intr_set_level(old_level);
 
-    printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
+    printf("%'" PRIu64 " kHz TSC.\n", tsc_hz / 1000);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -85,31 +155,13 @@ int64_t timer_elapsed(int64_t then) {
     return timer_ticks() - then;
 }
 
-struct list sleep_list;
-
-bool less_func(const struct list_elem *a, const struct list_elem *b, void *aux) {
-    struct thread *thread_a = list_entry(a, struct thread, elem);
-    struct thread *thread_b = list_entry(b, struct thread, elem);
-
-    return thread_a->ticks < thread_b->ticks;
-}
-
-void print_list(struct list *lst, int sig) {
-    struct list_elem *tmp = list_begin(lst);
-
-    if (sig)
-        printf("======delete=======\n");
-    else
-        printf("=================\n");
-    while (tmp != list_end(lst)) {
-        struct thread *tmp_t = list_entry(tmp, struct thread, elem);
-        printf("%s\n", tmp_t->name);
-        tmp = list_next(tmp);
-    }
-    if (sig)
-        printf("======delete=======\n");
-    else
-        printf("=================\n");
+/* Returns the number of nanoseconds since the OS booted.  Before
+     timer_calibrate(), only counts whole ticks.  Safe to call with
+     interrupts in any state, including from interrupt handlers. */
+int64_t timer_ns(void) {
+    if (tsc_hz == 0)
+        return timer_ticks() * (NSEC_PER_SEC / TIMER_FREQ);
+    return ns_base + (int64_t)(((unsigned __int128)(rdtsc() - tsc_base) * tsc_mult) >> TSC_SHIFT);
 }
 
 /* Suspends execution for approximately TICKS timer ticks. */
@@ -120,23 +172,17 @@ void timer_sleep(int64_t ticks) {
 
     ASSERT(intr_get_level() == INTR_ON);
 
-    // 들어왔을 때부터 얼마만큼 잤는지 < 자야되는 시간(ticks)
-    // 체크할 시간 - start < ticks
-    // timer_ticks() - start < ticks 
-    if (timer_elapsed(start) < ticks) {
-        old_level = intr_disable();
-        current_t->ticks = start + ticks;
-        // list_push_back(&sleep_list, &current_t->elem);
-        list_insert_ordered(&sleep_list, &current_t->elem, less_func, NULL);
-        // print_list(&sleep_list, 0);
+    old_level = intr_disable();
+    current_t->ticks = start + ticks;
+    /* The wake tick may already have passed while we were getting
+         here; there is nothing to wait for in that case. */
+    if (current_t->ticks > timer_ticks()) {
+        wheel_insert(current_t);
         thread_block();
-        intr_set_level(old_level);
     }
+    intr_set_level(old_level);
 }
 
-// void wake_thread(struct thread *t, ) {
-// }
-
 /* Suspends execution for approximately MS milliseconds. */
 void timer_msleep(int64_t ms) {
     real_time_sleep(ms, 1000);
@@ -157,55 +203,174 @@ void timer_print_stats(void) {
     printf("Timer: %" PRId64 " ticks\n", timer_ticks());
 }
 
+/* Programs the PIT to interrupt every timer tick. */
+static void pit_set_periodic(void) {
+    outb(0x43, 0x34); /* CW: counter 0, LSB then MSB, mode 2, binary. */
+    outb(0x40, pit_count & 0xff);
+    outb(0x40, pit_count >> 8);
+}
+
+/* Programs the PIT to interrupt once, COUNT input clocks from
+     now. */
+static void pit_set_oneshot(uint16_t count) {
+    outb(0x43, 0x30); /* CW: counter 0, LSB then MSB, mode 0, binary. */
+    outb(0x40, count & 0xff);
+    outb(0x40, count >> 8);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+     halts the CPU.  In tickless mode, replaces the periodic tick
+     by a single interrupt at the next sleeper's wake tick, bounded
+     by how far ahead the 16-bit PIT counter can reach, by the next
+     wheel cascade, by the next real-time budget replenishment or
+     delayed work expiry, and under MLFQS by the next whole
+     second. */
+void timer_idle_enter(void) {
+    int64_t max_ticks = UINT16_MAX / pit_count;
+    int64_t n;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!timer_tickless || oneshot_ticks != 0)
+        return;
+
+    if (thread_next_replenish() - ticks < max_ticks)
+        max_ticks = thread_next_replenish() - ticks;
+    if (workqueue_next_expiry() - ticks < max_ticks)
+        max_ticks = workqueue_next_expiry() - ticks;
+    for (n = 1; n < max_ticks; n++) {
+        int64_t next = ticks + n;
+        if (!list_empty(&wheel[0][next & WHEEL_MASK]) || (next & WHEEL_MASK) == 0)
+            break;
+        /* Keep the MLFQS once-per-second pass on schedule. */
+        if (thread_mlfqs && next % TIMER_FREQ == 0)
+            break;
+    }
+    if (n <= 1)
+        return;
+
+    oneshot_ticks = n;
+    pit_set_oneshot(n * pit_count);
+}
+
+/* Called by schedule(), with interrupts off, whenever it switches
+     away from the idle thread, before it picks the thread to run
+     next.  If something other than the one-shot timer woke the
+     CPU, accounts for the whole ticks that passed and resumes
+     periodic ticking.  Threads this wakes are made ready without
+     preempting; schedule() then considers them.  Up to one tick's
+     worth of time is lost to rounding each time this happens. */
+void timer_idle_exit(void) {
+    uint8_t status, lo, hi;
+    uint16_t remaining;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (oneshot_ticks == 0)
+        return;
+
+    /* Read back counter 0's status and count together. */
+    outb(0x43, 0xc2);
+    status = inb(0x40);
+    lo = inb(0x40);
+    hi = inb(0x40);
+
+    /* If OUT is already high, the one-shot interrupt is pending and
+         timer_interrupt() will do the catching up. */
+    if (status & 0x80)
+        return;
+
+    remaining = lo | (hi << 8);
+    pit_set_periodic();
+    timer_catch_up((oneshot_ticks * pit_count - remaining) / pit_count);
+    oneshot_ticks = 0;
+}
+
+/* Advances the tick count by ELAPSED ticks that passed with the
+     CPU idle, waking sleepers along the way. */
+static void timer_catch_up(int64_t elapsed) {
+    thread_account_idle(elapsed);
+    while (elapsed-- > 0) {
+        ticks++;
+        wheel_advance();
+        workqueue_timer_tick(ticks);
+    }
+}
+
 /* Timer interrupt handler. */
 static void timer_interrupt(struct intr_frame *args UNUSED) {
-    ticks++;
-
-    struct thread *front_t;
-    while(!list_empty(&sleep_list)) {
-        struct list_elem *front_e = list_front(&sleep_list);
-        front_t = list_entry(front_e, struct thread, elem);
-        if (front_t->ticks == ticks) {
-            list_remove(&front_t->elem);
-            // print_list(&sleep_list, 1);
-            thread_unblock(front_t);
-            if(!list_empty(&sleep_list) && list_entry(list_front(&sleep_list), struct thread, elem)->ticks == front_t->ticks)
-            {
-                continue;
-            }
-        }
-        break;
+    if (oneshot_ticks != 0) {
+        /* The one-shot deadline was reached.  Every tick but this
+             one was spent idle. */
+        pit_set_periodic();
+        timer_catch_up(oneshot_ticks - 1);
+        oneshot_ticks = 0;
     }
+    ticks++;
+    wheel_advance();
+    workqueue_timer_tick(ticks);
     thread_tick();
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-     tick, otherwise false. */
-static bool too_many_loops(unsigned loops) {
-    /* Wait for a timer tick. */
-    int64_t start = ticks;
-    while (ticks == start)
-        barrier();
+/* Files sleeping thread T in the timing wheel according to its
+     wake tick.  Interrupts must be off. */
+static void wheel_insert(struct thread *t) {
+    uint64_t diff = (uint64_t)(t->ticks ^ ticks);
+    int level;
 
-    /* Run LOOPS loops. */
-    start = ticks;
-    busy_wait(loops);
+    ASSERT(intr_get_level() == INTR_OFF);
 
-    /* If the tick count changed, we iterated too long. */
-    barrier();
-    return start != ticks;
+    /* A wake tick that is already due goes in the current level-0
+         slot, which is processed right after any cascading. */
+    if (t->ticks <= ticks) {
+        list_push_back(&wheel[0][ticks & WHEEL_MASK], &t->elem);
+        return;
+    }
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+        if ((diff >> (WHEEL_BITS * (level + 1))) == 0) {
+            int slot = (t->ticks >> (WHEEL_BITS * level)) & WHEEL_MASK;
+            list_push_back(&wheel[level][slot], &t->elem);
+            return;
+        }
+    list_push_back(&wheel_overflow, &t->elem);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-     brief delays.
+/* Re-files every thread on BUCKET relative to the current tick. */
+static void wheel_cascade(struct list *bucket) {
+    struct list pending;
 
-     Marked NO_INLINE because code alignment can significantly
-     affect timings, so that if this function was inlined
-     differently in different places the results would be difficult
-     to predict. */
-static void NO_INLINE busy_wait(int64_t loops) {
-    while (loops-- > 0)
-        barrier();
+    list_init(&pending);
+    while (!list_empty(bucket))
+        list_push_back(&pending, list_pop_front(bucket));
+    while (!list_empty(&pending))
+        wheel_insert(list_entry(list_pop_front(&pending), struct thread, elem));
+}
+
+/* Wakes every thread whose wake tick is at or before the current
+     tick.  Called once for every increment of `ticks'. */
+static void wheel_advance(void) {
+    struct list *bucket;
+    int level;
+
+    /* Cascade from the highest level that just wrapped around
+         down to level 1, so that threads due at this very tick end
+         up in the level-0 slot examined below. */
+    for (level = 1; level < WHEEL_LEVELS; level++)
+        if (((ticks >> (WHEEL_BITS * level)) << (WHEEL_BITS * level)) != ticks)
+            break;
+    if (level == WHEEL_LEVELS)
+        wheel_cascade(&wheel_overflow);
+    while (--level > 0)
+        wheel_cascade(&wheel[level][(ticks >> (WHEEL_BITS * level)) & WHEEL_MASK]);
+
+    bucket = &wheel[0][ticks & WHEEL_MASK];
+    while (!list_empty(bucket)) {
+        struct thread *t = list_entry(list_pop_front(bucket), struct thread, elem);
+
+        ASSERT(t->ticks <= ticks);
+        thread_unblock(t);
+    }
 }
 
 /* Sleep for approximately NUM/DENOM seconds. */
@@ -224,11 +389,13 @@ static void real_time_sleep(int64_t num, int32_t denom) {
              timer_sleep() because it will yield the CPU to other
              processes. */
         timer_sleep(ticks);
-    } else {
-        /* Otherwise, use a busy-wait loop for more accurate
-             sub-tick timing.  We scale the numerator and denominator
-             down by 1000 to avoid the possibility of overflow. */
-        ASSERT(denom % 1000 == 0);
-        busy_wait(loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+    } else if (num > 0) {
+        /* Otherwise, spin on the nanosecond clock for more accurate
+             sub-tick timing.  NUM / DENOM is under a tick here, so
+             NUM * NSEC_PER_SEC cannot overflow. */
+        int64_t end = timer_ns() + num * NSEC_PER_SEC / denom;
+
+        while (timer_ns() < end)
+            asm volatile("pause");
     }
 }
@@ -0,0 +1,67 @@
+#ifndef __LIB_KERNEL_PQUEUE_H
+#define __LIB_KERNEL_PQUEUE_H
+
+/* Priority queue.
+ *
+ * A max pairing heap keyed on an integer priority.  Like the
+ * doubly linked list in list.h, it does not allocate memory:
+ * each structure that can be queued embeds a struct pq_elem, and
+ * pq_entry() converts a struct pq_elem back to the structure
+ * that contains it.
+ *
+ * Elements with equal keys come out in the order in which they
+ * were pushed, so a queue of waiting threads keyed on priority
+ * is FIFO within each priority level.
+ *
+ * Costs, with N elements in the queue:
+ *
+ * - pq_push(), pq_top(), pq_empty(), pq_size(): O(1).
+ *
+ * - pq_pop(), pq_remove(): O(log N) amortized.
+ *
+ * - pq_update(): O(1) amortized when the key grows, O(log N)
+ *   amortized when it shrinks.
+ *
+ * An element may be in at most one queue at a time. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Priority queue element. */
+struct pq_elem {
+	struct pq_elem *child;      /* Leftmost child. */
+	struct pq_elem *next;       /* Right sibling. */
+	struct pq_elem *prev;       /* Left sibling, or parent if leftmost. */
+	int key;                    /* Priority. */
+	uint64_t seq;               /* Push order, for FIFO among equals. */
+};
+
+/* Priority queue. */
+struct pqueue {
+	struct pq_elem *root;       /* Highest-priority element. */
+	size_t size;                /* Number of elements. */
+	uint64_t next_seq;          /* Next element's `seq'. */
+};
+
+/* Converts pointer to priority queue element PQ_ELEM into a
+   pointer to the structure that PQ_ELEM is embedded inside.
+   Supply the name of the outer structure STRUCT and the member
+   name MEMBER of the queue element. */
+#define pq_entry(PQ_ELEM, STRUCT, MEMBER)               \
+	((STRUCT *) ((uint8_t *) &(PQ_ELEM)->child      \
+		- offsetof (STRUCT, MEMBER.child)))
+
+void pq_init (struct pqueue *);
+
+void pq_push (struct pqueue *, struct pq_elem *, int key);
+struct pq_elem *pq_pop (struct pqueue *);
+void pq_remove (struct pqueue *, struct pq_elem *);
+void pq_update (struct pqueue *, struct pq_elem *, int key);
+
+struct pq_elem *pq_top (struct pqueue *);
+bool pq_contains (const struct pqueue *, const struct pq_elem *);
+size_t pq_size (const struct pqueue *);
+bool pq_empty (const struct pqueue *);
+
+#endif /* lib/kernel/pqueue.h */
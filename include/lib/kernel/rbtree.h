@@ -0,0 +1,71 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+ *
+ * A balanced binary search tree ordered by a caller-supplied
+ * comparison function.  Like the other containers in this
+ * directory it does not allocate memory: each structure that can
+ * be in a tree embeds a struct rb_node, and rb_entry() converts a
+ * struct rb_node back to the structure that contains it.
+ *
+ * Elements that compare equal are kept in insertion order, so
+ * the tree can serve as a FIFO within each key.
+ *
+ * Costs, with N elements in the tree:
+ *
+ * - rb_insert(), rb_remove(): O(log N).
+ *
+ * - rb_first(), rb_size(), rb_empty(): O(1).  The leftmost node
+ *   is cached, which is what makes the tree usable as a run
+ *   queue.
+ *
+ * - rb_next(): O(log N) worst case, O(1) amortized over a full
+ *   traversal. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Red-black tree node. */
+struct rb_node {
+	struct rb_node *parent;     /* Parent, or null for the root. */
+	struct rb_node *left;       /* Left child. */
+	struct rb_node *right;      /* Right child. */
+	bool red;                   /* Red or black? */
+};
+
+/* Compares the values of two tree nodes A and B, given auxiliary
+ * data AUX.  Returns true if A is less than B, or false if A is
+ * greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_node *a,
+                           const struct rb_node *b, void *aux);
+
+/* Red-black tree. */
+struct rb_tree {
+	struct rb_node *root;       /* Root node, or null if empty. */
+	struct rb_node *first;      /* Leftmost node, or null if empty. */
+	size_t size;                /* Number of nodes. */
+	rb_less_func *less;         /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+/* Converts pointer to tree node RB_NODE into a pointer to the
+   structure that RB_NODE is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree node. */
+#define rb_entry(RB_NODE, STRUCT, MEMBER)               \
+	((STRUCT *) ((uint8_t *) &(RB_NODE)->parent     \
+		- offsetof (STRUCT, MEMBER.parent)))
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+
+void rb_insert (struct rb_tree *, struct rb_node *);
+void rb_remove (struct rb_tree *, struct rb_node *);
+
+struct rb_node *rb_first (const struct rb_tree *);
+struct rb_node *rb_next (const struct rb_node *);
+size_t rb_size (const struct rb_tree *);
+bool rb_empty (const struct rb_tree *);
+
+#endif /* lib/kernel/rbtree.h */
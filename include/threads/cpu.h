@@ -0,0 +1,42 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Processors.
+ *
+ * The kernel runs on a single processor, the bootstrap processor
+ * (BSP); there is no multiprocessor support.  cpu_init() only
+ * counts the other processors, from the ACPI tables the firmware
+ * leaves in memory, and does not start them: they stay parked in
+ * the firmware, waiting for a startup IPI.
+ *
+ * Per-processor state lives in struct cpu, and this_cpu() is
+ * always the BSP. */
+
+/* Most processors recorded. */
+#define CPU_MAX 16
+
+/* A processor. */
+struct cpu
+{
+    int id;            /* Index in cpus[]. */
+    uint8_t apic_id;   /* Local APIC ID. */
+    bool online;       /* Running kernel code? */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+extern uint64_t lapic_base;
+
+void cpu_init(void);
+
+/* Returns the processor we are running on. */
+static inline struct cpu *
+this_cpu(void)
+{
+    return &cpus[0];
+}
+
+#endif /* threads/cpu.h */
@@ -0,0 +1,27 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+ *
+ * A cache hands out objects of a single type, packed into pages
+ * ("slabs") with no per-object rounding beyond alignment, which
+ * suits objects that malloc() would round up to the next power
+ * of two.  See slab.c for details.
+ *
+ * If a cache has a constructor, objects come out of
+ * kmem_cache_alloc() in the state the constructor left them in
+ * or, if they were allocated before, in the state they were
+ * freed in: freed objects must be returned to their constructed
+ * state, e.g. with locks released. */
+
+struct kmem_cache;
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		size_t align, void (*ctor) (void *));
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -0,0 +1,18 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+struct intr_frame;
+
+/* Kernel-to-kernel context switch, in switch.S.
+ *
+ * Both routines push the callee-saved registers onto the current
+ * thread's stack and store its stack pointer in *CUR_RSP.
+ * thread_switch() then resumes the thread whose stack pointer was
+ * saved as NEXT_RSP; thread_switch_frame() starts a thread that
+ * has never run from its initial interrupt frame. */
+void thread_switch (uint64_t *cur_rsp, uint64_t next_rsp);
+void thread_switch_frame (uint64_t *cur_rsp, struct intr_frame *tf);
+
+#endif /* threads/switch.h */
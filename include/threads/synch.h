@@ -2,12 +2,15 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <pqueue.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
 
 /* A counting semaphore. */
 struct semaphore {
-    unsigned value;      /* Current value. */
-    struct list waiters; /* List of waiting threads. */
+    unsigned value;         /* Current value. */
+    struct pqueue waiters;  /* Waiting threads, by priority. */
 };
 
 void sema_init(struct semaphore *, unsigned value);
@@ -16,25 +19,36 @@ bool sema_try_down(struct semaphore *);  // 기다리지 않고 down or P 연산
 void sema_up(struct semaphore *);  
 void sema_self_test(void);
 
-bool decrease_sema_func(const struct list_elem *a, const struct list_elem *b, void *aux);
-// void donate_priority(struct lock *lock);
 
 
 /* Lock. */
 struct lock {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct pq_elem donation_elem; /* In holder's donations, see synch.c. */
+    struct lock_stat *stat;     /* Contention statistics, or null. */
+    int64_t acquired;           /* timer_ns() when holder acquired it. */
 };
 
-void lock_init(struct lock *);
+/* If true, lock_acquire() and lock_release() keep contention
+   statistics for each lock name, printed at shutdown.
+   Controlled by kernel command-line option "-lockprof". */
+extern bool lock_profiling;
+
+/* A lock is named after the expression passed to lock_init(),
+   e.g. "&tid_lock", so that all locks initialized in one place
+   share their statistics. */
+#define lock_init(LOCK) lock_init_named(LOCK, #LOCK)
+void lock_init_named(struct lock *, const char *name);
 void lock_acquire(struct lock *);      // 현재 쓰레드에서 락 획득, 기다려야하면 기다림
 bool lock_try_acquire(struct lock *);  // 기다리지 않고 락을 얻으려고함
 void lock_release(struct lock *);      // 락 소유 쓰레드만 락을 놓아줄 수 있다.
 bool lock_held_by_current_thread(const struct lock *);
+void lock_print_stats(void);
 
 /* Condition variable. */
 struct condition {
-    struct list waiters; /* List of waiting threads. */
+    struct pqueue waiters;  /* Waiting threads, by priority. */
 };
 
 void cond_init(struct condition *);
@@ -42,6 +56,43 @@ void cond_wait(struct condition *, struct lock *);  // 락을 갖고 이 함수
 void cond_signal(struct condition *, struct lock *);     // 락을 갖고 이 함수를 호출해야한다. cond를 기다리는 쓰레드 중 하나를 깨움
 void cond_broadcast(struct condition *, struct lock *);  // 락을 갖고 이 함수를 호출해야한다. cond를 기다리는 쓰레드가 있으면 모든 쓰레드를 깨움
 
+/* Readers-writer lock. */
+struct rwlock {
+    struct lock write_lock;     /* Held by the writer, briefly by entering readers. */
+    struct lock read_owner;     /* Never acquired; holder is a reader, see synch.c. */
+    struct semaphore drained;   /* Up'd when the last reader leaves. */
+    struct list readers;        /* Threads reading, oldest first. */
+    bool writer_waiting;        /* Writer waiting for readers to leave? */
+};
+
+void rwlock_init(struct rwlock *);
+void rwlock_acquire_read(struct rwlock *);   // 읽기 권한 획득, 쓰는 쓰레드가 있으면 기다림
+void rwlock_release_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);  // 쓰기 권한 획득, 모든 읽기/쓰기가 끝날 때까지 기다림
+void rwlock_release_write(struct rwlock *);
+bool rwlock_held_for_write(const struct rwlock *);
+
+/* Spinlock.
+ *
+ * Protects short sections that must not sleep, including ones
+ * shared with interrupt handlers: spin_lock_irqsave() turns
+ * interrupts off on this processor and then spins for the lock,
+ * which keeps out other processors.  With one processor, the
+ * lock is never found taken except by a bug, which it catches.
+ *
+ * A spinlock is held by a processor, not a thread, so it may be
+ * used before threads are set up.  A zeroed spinlock is unlocked,
+ * so static ones need no spin_lock_init(). */
+struct spinlock {
+    volatile int locked;        /* 1 while held. */
+    struct cpu *holder;         /* Processor holding it (for debugging). */
+};
+
+void spin_lock_init(struct spinlock *);
+enum intr_level spin_lock_irqsave(struct spinlock *);
+void spin_unlock_irqrestore(struct spinlock *, enum intr_level);
+bool spin_lock_held(const struct spinlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
@@ -3,8 +3,10 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
 
+#include "threads/fixed-point.h"
 #include "threads/synch.h"
 #include "threads/interrupt.h"
 
@@ -21,8 +23,8 @@ enum thread_status
     THREAD_DYING    /* About to be destroyed. */
 };
 void run_highest_priority_thread(int curr_priority);
-
-extern struct list sleep_list;
+void thread_set_effective_priority(struct thread *t, int priority);
+void thread_refresh_priority(struct thread *t);
 
 /* Thread identifier type.
    You can redefine this to whatever type you like. */
@@ -34,6 +36,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX 63     /* Highest priority. */
 
+/* Thread nice values, used by the MLFQS and CFS schedulers. */
+#define NICE_MIN -20    /* Nicest to other threads. */
+#define NICE_DEFAULT 0  /* Default nice value. */
+#define NICE_MAX 20     /* Least nice to other threads. */
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -105,15 +112,42 @@ struct thread
     /* 현재 스레드가 얼만큼 실행했는지에 대한 틱 */
     long long ticks;
 
+    /* MLFQS */
+    int nice;                   /* Niceness toward other threads. */
+    fixed_t recent_cpu;         /* Decaying estimate of CPU time used. */
+    struct list_elem all_elem;  /* List element for all threads list. */
+
+    /* CFS */
+    int64_t vruntime;           /* Weighted run time, see thread.c. */
+    struct rb_node cfs_node;    /* Element in the CFS run queue. */
+
+    /* Real-time class, see thread_set_deadline(). */
+    int64_t rt_runtime;         /* Budget per period in ticks, 0 if not real-time. */
+    int64_t rt_deadline;        /* Relative deadline in ticks. */
+    int64_t rt_period;          /* Period in ticks. */
+    int64_t rt_bw;              /* Reserved bandwidth, see thread.c. */
+    int64_t rt_abs_deadline;    /* Deadline of the current period. */
+    int64_t rt_next_period;     /* Start of the next period. */
+    int64_t rt_budget;          /* Budget left in the current period. */
+    bool rt_throttled;          /* Budget used up until rt_next_period? */
+    struct rb_node rt_node;     /* Element in the real-time run queue. */
+
     /* Shared between thread.c and synch.c. */
     struct list_elem elem; /* List element. */
 
+    /* Owned by synch.c. */
+    struct pq_elem wait_elem;     /* Element in a semaphore's waiters. */
+    struct pqueue *wait_queue;    /* Semaphore queue blocked in, if any. */
+    struct pq_elem *cond_elem;    /* Element in a condition's waiters. */
+    struct pqueue *cond_queue;    /* Condition queue waited in, if any. */
+    struct list_elem read_elem;   /* Element in an rwlock's readers. */
+
     /* 도네이션 */
-    struct list donation_list;
+    struct pqueue donations;      /* Held locks with waiters, by priority. */
     struct lock *wait_on_lock;
-    struct list_elem donation_elem;
     /*  File Descriptor*/
-    struct file **fdt;
+    struct file **fdt; /* Allocated on first use. */
+    int fdt_size;      /* Number of slots in fdt. */
     int64_t next_fd;
 
     /* for fork */
@@ -142,6 +176,7 @@ struct thread
 
     /* Owned by thread.c. */
     struct intr_frame tf; /* Information for switching */
+    uint64_t switch_rsp;  /* Saved stack pointer, 0 if never switched out. */
     struct intr_frame fork_tf;
     unsigned magic; /* Detects stack overflow. */
 };
@@ -151,10 +186,17 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler, which shares the
+   CPU in proportion to weights derived from nice values and
+   ignores priorities.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init(void);  // struct thread 생성
 void thread_start(void); // 스케쥴러 시작
 
 void thread_tick(void);        // 각 타이머 tick에서 발생하는 타이머 인터럽트로부터 호출된다. 이 함수는 스레드 통계를 추적하고, 타임 슬라이스가 만료될 때 스케쥴러를 작동시킨다.
+void thread_account_idle(int64_t skipped);
 void thread_print_stats(void); // Pintos가 종료될 때 스레드 통계를 출력하기 위해 호출된다.
 
 typedef void thread_func(void *aux); // 쓰레드 루틴
@@ -178,11 +220,16 @@ void thread_set_nice(int);
 int thread_get_recent_cpu(void);
 int thread_get_load_avg(void);
 
+bool thread_set_deadline(int64_t runtime, int64_t deadline, int64_t period);
+void thread_clear_deadline(void);
+void thread_yield_deadline(void);
+int64_t thread_get_deadline(void);
+int64_t thread_next_replenish(void);
+
 struct thread *get_child_process(tid_t tid);
 void remove_child_process(tid_t tid);
 
 void do_iret(struct intr_frame *tf);
 
-bool decrease_func(const struct list_elem *a, const struct list_elem *b, void *aux);
 
 #endif /* threads/thread.h */
@@ -0,0 +1,70 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Deferred work.
+ *
+ * A work item is a function to be called later, in thread
+ * context, by one of a small pool of kernel worker threads.
+ * Interrupt handlers use it to move anything slow or anything
+ * that may sleep out of interrupt context; other code uses it to
+ * run things asynchronously or, with delayed work, after a
+ * timeout.
+ *
+ * Work items are embedded in the structure they act on, so
+ * queuing one never allocates memory and may be done from an
+ * interrupt handler.  An item is queued at most once at a time:
+ * queuing an item that is already pending does nothing, so a
+ * burst of events is handled by a single call.  Queuing an item
+ * while it runs makes it run once more afterward.  An item never
+ * runs on two workers at once. */
+
+struct work;
+typedef void work_func(struct work *);
+
+/* A work item. */
+struct work
+{
+    struct list_elem elem; /* Element in the pending list. */
+    work_func *func;       /* Function to call. */
+    bool pending;          /* Queued and not yet started? */
+    uint64_t seq;          /* Queuing order, for flushing. */
+};
+
+/* A work item that is queued after a delay. */
+struct delayed_work
+{
+    struct work work;            /* The work item proper. */
+    struct list_elem timer_elem; /* Element in the timer list. */
+    int64_t expires;             /* Tick at which `work' is queued. */
+    bool timer_pending;          /* Waiting for `expires'? */
+};
+
+/* Converts pointer to work item WORK into a pointer to the
+   structure that WORK is embedded inside.  Supply the name of the
+   outer structure STRUCT and the member name MEMBER of the work
+   item, e.g. `dwork.work' for a struct delayed_work. */
+#define work_entry(WORK, STRUCT, MEMBER)                \
+    ((STRUCT *)((uint8_t *)&(WORK)->elem - offsetof(STRUCT, MEMBER.elem)))
+
+void workqueue_init(void);
+void workqueue_start(void);
+void workqueue_print_stats(void);
+
+void work_init(struct work *, work_func *);
+void delayed_work_init(struct delayed_work *, work_func *);
+
+bool queue_work(struct work *);
+bool queue_delayed_work(struct delayed_work *, int64_t ticks);
+bool cancel_delayed_work(struct delayed_work *);
+void flush_work(struct work *);
+void flush_workqueue(void);
+
+void workqueue_timer_tick(int64_t now);
+int64_t workqueue_next_expiry(void);
+
+#endif /* threads/workqueue.h */
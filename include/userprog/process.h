@@ -11,6 +11,7 @@ void process_exit(void);
 void process_activate(struct thread *next);
 
 /* file descriptor */
+bool process_fdt_reserve(struct thread *t, int fd);
 int process_add_file(struct file *f);
 void process_close_file(int fd);
 struct file *process_get_file(int);
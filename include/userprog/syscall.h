@@ -1,8 +1,6 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
-extern struct lock rw_lock;
-
 void syscall_init (void);
 
 #endif /* userprog/syscall.h */
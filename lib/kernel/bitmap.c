@@ -62,6 +62,68 @@ last_mask (const struct bitmap *b) {
 	int last_bits = b->bit_cnt % ELEM_BITS;
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/* Word-at-a-time helpers.
+
+   The functions that test or set ranges of bits work on whole
+   elements: each element is turned into a word whose 1 bits are
+   the bits set to the VALUE being looked for, masked down to the
+   part of the range it covers, and then tested, counted, or
+   searched with a single operation. */
+
+/* Returns element IDX of B with the bits that are set to VALUE
+   turned on and the others turned off. */
+static inline elem_type
+elem_match (const struct bitmap *b, size_t idx, bool value) {
+	return value ? b->bits[idx] : ~b->bits[idx];
+}
+
+/* Returns a mask of the bits of element IDX that represent bits
+   START through END, exclusive, in the bitmap.  The range must
+   overlap the element. */
+static inline elem_type
+range_mask (size_t idx, size_t start, size_t end) {
+	size_t first = idx * ELEM_BITS;
+	elem_type mask = (elem_type) -1;
+
+	if (start > first)
+		mask &= ~(bit_mask (start) - 1);
+	if (end < first + ELEM_BITS)
+		mask &= bit_mask (end) - 1;
+	return mask;
+}
+
+/* Returns the number of 1 bits in W.  Written out because without
+   -mpopcnt, GCC turns __builtin_popcountl() into a call into
+   libgcc, which the kernel does not link against. */
+static inline size_t
+popcount (elem_type w) {
+	w = w - ((w >> 1) & 0x5555555555555555UL);
+	w = (w & 0x3333333333333333UL) + ((w >> 2) & 0x3333333333333333UL);
+	w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (w * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none. */
+static size_t
+find_next (const struct bitmap *b, size_t start, size_t end, bool value) {
+	size_t idx;
+	elem_type w;
+
+	if (start >= end)
+		return end;
+
+	idx = elem_idx (start);
+	w = elem_match (b, idx, value) & ~(bit_mask (start) - 1);
+	while (w == 0) {
+		if (++idx * ELEM_BITS >= end)
+			return end;
+		w = elem_match (b, idx, value);
+	}
+	start = idx * ELEM_BITS + __builtin_ctzl (w);
+	return start < end ? start : end;
+}
 
 /* Creation and destruction. */
 
@@ -203,8 +265,16 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	for (i = elem_idx (start); i * ELEM_BITS < start + cnt; i++) {
+		elem_type mask = range_mask (i, start, start + cnt);
+
+		/* Atomic for each element, as in bitmap_mark() and
+		   bitmap_reset(). */
+		if (value)
+			asm ("lock orq %1, %0" : "=m" (b->bits[i]) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "=m" (b->bits[i]) : "r" (~mask) : "cc");
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -218,9 +288,9 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (start + cnt <= b->bit_cnt);
 
 	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
+	for (i = elem_idx (start); i * ELEM_BITS < start + cnt; i++)
+		value_cnt += popcount (elem_match (b, i, value)
+				& range_mask (i, start, start + cnt));
 	return value_cnt;
 }
 
@@ -228,16 +298,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			return true;
-	return false;
+	return find_next (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -266,18 +331,29 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Alternately finds the next bit set to VALUE, where a group
+   could begin, and the next bit after it set to !VALUE, where the
+   group would end.  Each search skips whole elements, and the
+   second one stops looking once the group is long enough. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 
-	if (cnt <= b->bit_cnt) {
-		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
-				return i;
+	if (cnt == 0)
+		return start;
+	while (cnt <= b->bit_cnt - start) {
+		size_t end;
+
+		start = find_next (b, start, b->bit_cnt - cnt + 1, value);
+		if (start > b->bit_cnt - cnt)
+			break;
+		end = find_next (b, start + 1, start + cnt, !value);
+		if (end == start + cnt)
+			return start;
+		start = end + 1;
 	}
 	return BITMAP_ERROR;
 }
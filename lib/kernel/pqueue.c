@@ -0,0 +1,197 @@
+#include "pqueue.h"
+#include "../debug.h"
+
+/* A pairing heap is a tree in which every node's key is at least
+   as large as its children's.  Each node points to its leftmost
+   child, the children of a node are linked into a doubly linked
+   list through `next' and `prev', and the leftmost child's `prev'
+   points back to the parent.  The root has no siblings and a null
+   `prev'.
+
+   Two heaps are melded by making the root with the smaller key
+   the leftmost child of the other.  Removing the root melds its
+   children pairwise from left to right and then melds the pairs
+   from right to left, which is what makes the amortized costs
+   logarithmic. */
+
+/* Returns true if A should leave the queue before B. */
+static inline bool
+before (const struct pq_elem *a, const struct pq_elem *b) {
+	return a->key > b->key || (a->key == b->key && a->seq < b->seq);
+}
+
+/* Melds the heaps rooted at A and B, which must not have
+   siblings, and returns the new root. */
+static struct pq_elem *
+meld (struct pq_elem *a, struct pq_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (before (b, a)) {
+		struct pq_elem *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Melds the sibling list starting at FIRST into a single heap
+   with the two-pass pairing method and returns its root.
+   Iterative, so that stack usage does not depend on the shape of
+   the heap. */
+static struct pq_elem *
+merge_pairs (struct pq_elem *first) {
+	struct pq_elem *pairs = NULL;
+	struct pq_elem *root = NULL;
+
+	/* Left to right, meld siblings pairwise, stacking the results
+	   through their `next' links. */
+	while (first != NULL) {
+		struct pq_elem *a = first;
+		struct pq_elem *b = a->next;
+		struct pq_elem *m;
+
+		first = b != NULL ? b->next : NULL;
+		a->prev = a->next = NULL;
+		if (b != NULL)
+			b->prev = b->next = NULL;
+		m = meld (a, b);
+		m->next = pairs;
+		pairs = m;
+	}
+
+	/* Right to left, meld the pairs together. */
+	while (pairs != NULL) {
+		struct pq_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = meld (root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+/* Cuts non-root element E, along with its subtree, out of the
+   heap that contains it. */
+static void
+detach (struct pq_elem *e) {
+	ASSERT (e->prev != NULL);
+
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	e->prev = e->next = NULL;
+}
+
+/* Initializes PQ as an empty priority queue. */
+void
+pq_init (struct pqueue *pq) {
+	ASSERT (pq != NULL);
+	pq->root = NULL;
+	pq->size = 0;
+	pq->next_seq = 0;
+}
+
+/* Inserts ELEM into PQ with priority KEY. */
+void
+pq_push (struct pqueue *pq, struct pq_elem *elem, int key) {
+	ASSERT (pq != NULL);
+	ASSERT (elem != NULL);
+
+	elem->child = elem->next = elem->prev = NULL;
+	elem->key = key;
+	elem->seq = pq->next_seq++;
+	pq->root = meld (pq->root, elem);
+	pq->size++;
+}
+
+/* Removes and returns the element of PQ with the highest
+   priority, the earliest pushed among equals.  Undefined
+   behavior if PQ is empty. */
+struct pq_elem *
+pq_pop (struct pqueue *pq) {
+	struct pq_elem *top = pq_top (pq);
+
+	pq_remove (pq, top);
+	return top;
+}
+
+/* Removes ELEM, which must be in PQ, from PQ. */
+void
+pq_remove (struct pqueue *pq, struct pq_elem *elem) {
+	struct pq_elem *children;
+
+	ASSERT (pq_contains (pq, elem));
+
+	children = merge_pairs (elem->child);
+	elem->child = NULL;
+	if (pq->root == elem)
+		pq->root = children;
+	else {
+		detach (elem);
+		pq->root = meld (pq->root, children);
+	}
+	pq->size--;
+}
+
+/* Changes the priority of ELEM, which must be in PQ, to KEY.
+   ELEM keeps its place relative to other elements of equal
+   priority. */
+void
+pq_update (struct pqueue *pq, struct pq_elem *elem, int key) {
+	ASSERT (pq_contains (pq, elem));
+
+	if (key >= elem->key) {
+		elem->key = key;
+		if (pq->root != elem) {
+			detach (elem);
+			pq->root = meld (pq->root, elem);
+		}
+	} else {
+		uint64_t seq = elem->seq;
+
+		pq_remove (pq, elem);
+		elem->child = elem->next = elem->prev = NULL;
+		elem->key = key;
+		elem->seq = seq;
+		pq->root = meld (pq->root, elem);
+		pq->size++;
+	}
+}
+
+/* Returns the element of PQ with the highest priority, without
+   removing it.  Undefined behavior if PQ is empty. */
+struct pq_elem *
+pq_top (struct pqueue *pq) {
+	ASSERT (!pq_empty (pq));
+	return pq->root;
+}
+
+/* Returns true if ELEM is in PQ.  ELEM must be in PQ or in no
+   queue at all. */
+bool
+pq_contains (const struct pqueue *pq, const struct pq_elem *elem) {
+	return pq->root == elem || elem->prev != NULL;
+}
+
+/* Returns the number of elements in PQ. */
+size_t
+pq_size (const struct pqueue *pq) {
+	return pq->size;
+}
+
+/* Returns true if PQ is empty, false otherwise. */
+bool
+pq_empty (const struct pqueue *pq) {
+	return pq->root == NULL;
+}
@@ -0,0 +1,306 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* The tree follows the usual red-black rules, with null pointers
+   standing in for the black leaves:
+
+   1. The root is black.
+
+   2. A red node has no red child.
+
+   3. Every path from a node down to a leaf passes through the
+      same number of black nodes.
+
+   Together these keep the longest path from the root at most
+   twice as long as the shortest.  Insertion and removal restore
+   them with the fix-up procedures from Cormen et al.,
+   "Introduction to Algorithms", chapter 13. */
+
+static inline bool
+is_red (const struct rb_node *n) {
+	return n != NULL && n->red;
+}
+
+/* Returns the leftmost node of the subtree rooted at N. */
+static struct rb_node *
+minimum (struct rb_node *n) {
+	while (n->left != NULL)
+		n = n->left;
+	return n;
+}
+
+/* Puts V, which may be null, in the place of U in U's parent. */
+static void
+replace_child (struct rb_tree *tree, struct rb_node *u, struct rb_node *v) {
+	if (u->parent == NULL)
+		tree->root = v;
+	else if (u == u->parent->left)
+		u->parent->left = v;
+	else
+		u->parent->right = v;
+	if (v != NULL)
+		v->parent = u->parent;
+}
+
+/* Rotates the subtree rooted at X to the left, so that X's right
+   child takes its place and X becomes that child's left child. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_node *x) {
+	struct rb_node *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	replace_child (tree, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+/* Mirror image of rotate_left(). */
+static void
+rotate_right (struct rb_tree *tree, struct rb_node *x) {
+	struct rb_node *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	replace_child (tree, x, y);
+	y->right = x;
+	x->parent = y;
+}
+
+/* Restores the red-black rules after red node N was added as a
+   leaf. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_node *n) {
+	struct rb_node *p;
+
+	while (is_red (p = n->parent)) {
+		/* P is red, so it is not the root and has a parent. */
+		struct rb_node *g = p->parent;
+
+		if (p == g->left) {
+			struct rb_node *u = g->right;
+
+			if (is_red (u)) {
+				p->red = u->red = false;
+				g->red = true;
+				n = g;
+				continue;
+			}
+			if (n == p->right) {
+				rotate_left (tree, p);
+				n = p;
+				p = n->parent;
+			}
+			p->red = false;
+			g->red = true;
+			rotate_right (tree, g);
+		} else {
+			struct rb_node *u = g->left;
+
+			if (is_red (u)) {
+				p->red = u->red = false;
+				g->red = true;
+				n = g;
+				continue;
+			}
+			if (n == p->left) {
+				rotate_right (tree, p);
+				n = p;
+				p = n->parent;
+			}
+			p->red = false;
+			g->red = true;
+			rotate_left (tree, g);
+		}
+	}
+	tree->root->red = false;
+}
+
+/* Restores the red-black rules after a black node was removed
+   from above X, which may be null, leaving the paths through X
+   one black node short.  P is X's parent. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_node *x, struct rb_node *p) {
+	while (x != tree->root && !is_red (x)) {
+		/* The paths through X's sibling W have at least one black
+		   node more than those through X, so W is not null. */
+		if (x == p->left) {
+			struct rb_node *w = p->right;
+
+			if (w->red) {
+				w->red = false;
+				p->red = true;
+				rotate_left (tree, p);
+				w = p->right;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = p;
+				p = x->parent;
+				continue;
+			}
+			if (!is_red (w->right)) {
+				w->left->red = false;
+				w->red = true;
+				rotate_right (tree, w);
+				w = p->right;
+			}
+			w->red = p->red;
+			p->red = false;
+			w->right->red = false;
+			rotate_left (tree, p);
+		} else {
+			struct rb_node *w = p->left;
+
+			if (w->red) {
+				w->red = false;
+				p->red = true;
+				rotate_right (tree, p);
+				w = p->left;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = p;
+				p = x->parent;
+				continue;
+			}
+			if (!is_red (w->left)) {
+				w->right->red = false;
+				w->red = true;
+				rotate_left (tree, w);
+				w = p->left;
+			}
+			w->red = p->red;
+			p->red = false;
+			w->left->red = false;
+			rotate_right (tree, p);
+		}
+		x = tree->root;
+	}
+	if (x != NULL)
+		x->red = false;
+}
+
+/* Initializes TREE as an empty tree ordered by LESS, which is
+   passed auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux) {
+	ASSERT (tree != NULL);
+	ASSERT (less != NULL);
+
+	tree->root = tree->first = NULL;
+	tree->size = 0;
+	tree->less = less;
+	tree->aux = aux;
+}
+
+/* Inserts NODE into TREE, after any nodes that compare equal to
+   it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_node *node) {
+	struct rb_node **link = &tree->root;
+	struct rb_node *parent = NULL;
+	bool leftmost = true;
+
+	ASSERT (tree != NULL);
+	ASSERT (node != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		if (tree->less (node, parent, tree->aux))
+			link = &parent->left;
+		else {
+			link = &parent->right;
+			leftmost = false;
+		}
+	}
+
+	node->parent = parent;
+	node->left = node->right = NULL;
+	node->red = true;
+	*link = node;
+	if (leftmost)
+		tree->first = node;
+	tree->size++;
+	insert_fixup (tree, node);
+}
+
+/* Removes NODE, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_node *node) {
+	struct rb_node *x, *x_parent;
+	bool removed_red;
+
+	ASSERT (tree != NULL);
+	ASSERT (node != NULL);
+	ASSERT (tree->size > 0);
+
+	if (tree->first == node)
+		tree->first = rb_next (node);
+
+	if (node->left == NULL || node->right == NULL) {
+		/* NODE has at most one child, which takes its place. */
+		x = node->left != NULL ? node->left : node->right;
+		x_parent = node->parent;
+		removed_red = node->red;
+		replace_child (tree, node, x);
+	} else {
+		/* NODE's successor Y, which has no left child, moves into
+		   NODE's place, and Y's right child X into Y's. */
+		struct rb_node *y = minimum (node->right);
+
+		x = y->right;
+		removed_red = y->red;
+		if (y->parent == node)
+			x_parent = y;
+		else {
+			x_parent = y->parent;
+			replace_child (tree, y, x);
+			y->right = node->right;
+			y->right->parent = y;
+		}
+		replace_child (tree, node, y);
+		y->left = node->left;
+		y->left->parent = y;
+		y->red = node->red;
+	}
+
+	if (!removed_red)
+		remove_fixup (tree, x, x_parent);
+	node->parent = node->left = node->right = NULL;
+	tree->size--;
+}
+
+/* Returns the smallest node in TREE, or a null pointer if TREE is
+   empty. */
+struct rb_node *
+rb_first (const struct rb_tree *tree) {
+	return tree->first;
+}
+
+/* Returns the node that follows NODE in its tree, or a null
+   pointer if NODE is the largest. */
+struct rb_node *
+rb_next (const struct rb_node *node) {
+	ASSERT (node != NULL);
+
+	if (node->right != NULL)
+		return minimum (node->right);
+	while (node->parent != NULL && node == node->parent->right)
+		node = node->parent;
+	return node->parent;
+}
+
+/* Returns the number of nodes in TREE. */
+size_t
+rb_size (const struct rb_tree *tree) {
+	return tree->size;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree) {
+	return tree->root == NULL;
+}
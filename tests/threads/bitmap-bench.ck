@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "missing begin message\n"
+  if !grep ($_ eq '(bitmap-bench) begin', @output);
+fail "missing end message\n"
+  if !grep ($_ eq '(bitmap-bench) end', @output);
+
+my ($scan) = map (/^\(bitmap-bench\) Scanned \d+ bits in (\d+) ns\.$/, @output);
+fail "missing scan time\n" if !defined $scan;
+my ($count) = map (/^\(bitmap-bench\) Counted \d+ bits in (\d+) ns\.$/, @output);
+fail "missing count time\n" if !defined $count;
+print "$scan ns per scan, $count ns per count.\n";
+pass;
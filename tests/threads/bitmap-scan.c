@@ -0,0 +1,139 @@
+/* Checks the bitmap's range operations against bit-at-a-time
+   versions of them and measures how fast they are.
+
+   Random bitmaps of awkward sizes, with random densities, are
+   queried with bitmap_count(), bitmap_contains(), and
+   bitmap_scan() at random places, and every answer is compared
+   with one worked out by testing one bit at a time.
+
+   The bitmap-bench benchmark then scans a large bitmap that is
+   nearly all set, with single clear bits scattered through it,
+   for two clear bits in a row, which means reading the whole
+   bitmap without finding any.  The times depend on the host, so
+   it only reports them for comparison between kernels. */
+
+#include <bitmap.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "devices/timer.h"
+
+/* Number of random bitmaps to check, and queries on each. */
+#define CHECK_CNT 500
+#define QUERY_CNT 20
+
+/* Largest random bitmap, in bits. */
+#define CHECK_BITS 300
+
+/* Size of the benchmark bitmap, in bits, and distance between
+   its clear bits. */
+#define BENCH_BITS (1 << 18)
+#define BENCH_GAP 100
+
+/* Times to repeat each benchmark. */
+#define BENCH_REPS 10
+
+static size_t slow_scan (const struct bitmap *, size_t start, size_t cnt,
+                         bool value);
+
+void
+test_bitmap_scan (void) 
+{
+  struct bitmap *b;
+  size_t i;
+  int n;
+
+  for (n = 0; n < CHECK_CNT; n++) 
+    {
+      size_t bit_cnt = random_ulong () % CHECK_BITS;
+      unsigned density = random_ulong () % 101;
+      int q;
+
+      b = bitmap_create (bit_cnt);
+      if (b == NULL)
+        fail ("couldn't create a %zu-bit bitmap", bit_cnt);
+      for (i = 0; i < bit_cnt; i++)
+        bitmap_set (b, i, random_ulong () % 100 < density);
+
+      for (q = 0; q < QUERY_CNT; q++) 
+        {
+          size_t ofs = random_ulong () % (bit_cnt + 1);
+          size_t cnt = random_ulong () % (bit_cnt - ofs + 1);
+          size_t run = random_ulong () % 8;
+          bool value = random_ulong () % 2;
+          size_t value_cnt = 0;
+
+          for (i = ofs; i < ofs + cnt; i++)
+            if (bitmap_test (b, i) == value)
+              value_cnt++;
+          if (bitmap_count (b, ofs, cnt, value) != value_cnt)
+            fail ("bitmap_count() of %zu bits at %zu in %zu-bit bitmap "
+                  "is %zu, should be %zu", cnt, ofs, bit_cnt,
+                  bitmap_count (b, ofs, cnt, value), value_cnt);
+          if (bitmap_contains (b, ofs, cnt, value) != (value_cnt > 0))
+            fail ("bitmap_contains() of %zu bits at %zu in %zu-bit bitmap "
+                  "is wrong", cnt, ofs, bit_cnt);
+          if (bitmap_scan (b, ofs, run, value)
+              != slow_scan (b, ofs, run, value))
+            fail ("bitmap_scan() for %zu bits from %zu in %zu-bit bitmap "
+                  "is %zu, should be %zu", run, ofs, bit_cnt,
+                  bitmap_scan (b, ofs, run, value),
+                  slow_scan (b, ofs, run, value));
+        }
+      bitmap_destroy (b);
+    }
+  msg ("Checked %d random bitmaps.", CHECK_CNT);
+}
+
+void
+test_bitmap_bench (void) 
+{
+  struct bitmap *b;
+  int64_t start;
+  size_t i;
+  int n;
+
+  b = bitmap_create (BENCH_BITS);
+  if (b == NULL)
+    fail ("couldn't create a %d-bit bitmap", BENCH_BITS);
+  bitmap_set_all (b, true);
+  for (i = BENCH_GAP / 2; i < BENCH_BITS; i += BENCH_GAP)
+    bitmap_reset (b, i);
+
+  start = timer_ns ();
+  for (n = 0; n < BENCH_REPS; n++)
+    if (bitmap_scan (b, 0, 2, false) != BITMAP_ERROR)
+      fail ("found two clear bits in a row");
+  msg ("Scanned %d bits in %lld ns.", BENCH_BITS,
+       (timer_ns () - start) / BENCH_REPS);
+
+  start = timer_ns ();
+  for (n = 0; n < BENCH_REPS; n++)
+    if (bitmap_count (b, 0, BENCH_BITS, false)
+        != (BENCH_BITS - BENCH_GAP / 2 + BENCH_GAP - 1) / BENCH_GAP)
+      fail ("wrong count of clear bits");
+  msg ("Counted %d bits in %lld ns.", BENCH_BITS,
+       (timer_ns () - start) / BENCH_REPS);
+
+  bitmap_destroy (b);
+}
+
+/* Returns what bitmap_scan (B, START, CNT, VALUE) should,
+   testing one bit at a time. */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  size_t bit_cnt = bitmap_size (b);
+  size_t i, j;
+
+  for (i = start; cnt <= bit_cnt && i <= bit_cnt - cnt; i++) 
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
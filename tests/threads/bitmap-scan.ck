@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(bitmap-scan) begin
+(bitmap-scan) Checked 500 random bitmaps.
+(bitmap-scan) end
+EOF
+pass;
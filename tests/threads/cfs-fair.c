@@ -0,0 +1,41 @@
+/* Checks that the completely fair scheduler divides the CPU in
+   proportion to the weights of the runnable threads.
+
+   The cfs-fair-2 test runs 2 threads both niced to 0, which
+   should each receive about 1,500 of the 3,000 ticks in the 30
+   seconds they spin.
+
+   The cfs-nice-2 test runs 2 threads, one with nice 0, the
+   other with nice 5.  Their weights are 1024 and 335, so they
+   should receive about 2,260 and 740 ticks, respectively.
+
+   (The expected values are computed in cfs.pm.  The threads
+   themselves are run by fair_spin() in fair.c.) */
+
+#include <debug.h>
+#include "tests/threads/tests.h"
+#include "threads/thread.h"
+
+static void test_cfs_fair (int thread_cnt, int nice_min, int nice_step);
+
+void
+test_cfs_fair_2 (void) 
+{
+  test_cfs_fair (2, 0, 0);
+}
+
+void
+test_cfs_nice_2 (void) 
+{
+  test_cfs_fair (2, 0, 5);
+}
+
+static void
+test_cfs_fair (int thread_cnt, int nice_min, int nice_step)
+{
+  ASSERT (thread_cfs);
+  ASSERT (nice_min >= NICE_MIN);
+  ASSERT (nice_min + nice_step * (thread_cnt - 1) <= NICE_MAX);
+
+  fair_spin (thread_cnt, nice_min, nice_step);
+}
@@ -0,0 +1,80 @@
+/* Runs a periodic real-time job against CPU-bound threads of the
+   highest ordinary priority and checks that the job never misses
+   the deadline the scheduler gave it.  Also checks that admission
+   control turns down a reservation that would overcommit the
+   CPU. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define LOAD_CNT 4      /* Number of background threads. */
+#define JOB_CNT 50      /* Number of periods to run for. */
+#define RUNTIME 3       /* Budget per period, in ticks. */
+#define DEADLINE 5      /* Relative deadline, in ticks. */
+#define PERIOD 10       /* Period, in ticks. */
+
+static thread_func load_thread;
+static volatile bool done;
+
+void
+test_edf_deadline (void) 
+{
+  int misses = 0;
+  int i;
+
+  /* Invalid parameters and overcommitment are refused. */
+  if (thread_set_deadline (DEADLINE + 1, DEADLINE, PERIOD))
+    fail ("accepted runtime longer than deadline");
+  if (!thread_set_deadline (RUNTIME, DEADLINE, PERIOD))
+    fail ("reservation refused");
+  msg ("Reservation accepted.");
+  if (thread_set_deadline (DEADLINE, DEADLINE, PERIOD))
+    fail ("accepted a reservation of the whole CPU");
+  msg ("Overcommitted reservation rejected.");
+
+  /* Even at the highest priority, the load threads must not get
+     in our way. */
+  for (i = 0; i < LOAD_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_MAX, load_thread, NULL);
+    }
+  msg ("Running %d jobs against %d CPU-bound threads...",
+       JOB_CNT, LOAD_CNT);
+
+  for (i = 0; i < JOB_CNT; i++)
+    {
+      /* Each period's deadline is counted from when the scheduler
+         actually released us, which may be later than a multiple
+         of PERIOD after the first release. */
+      int64_t deadline = thread_get_deadline ();
+      int64_t start = timer_ticks ();
+
+      /* One job: a tick's worth of work. */
+      while (timer_ticks () == start)
+        continue;
+
+      if (timer_ticks () > deadline)
+        misses++;
+      thread_yield_deadline ();
+    }
+
+  /* Let the load threads exit, then drop the reservation, after
+     which they would keep us from running. */
+  done = true;
+  thread_clear_deadline ();
+
+  msg ("%d deadline misses in %d periods.", misses, JOB_CNT);
+}
+
+static void
+load_thread (void *aux UNUSED) 
+{
+  while (!done)
+    continue;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline) begin
+(edf-deadline) Reservation accepted.
+(edf-deadline) Overcommitted reservation rejected.
+(edf-deadline) Running 50 jobs against 4 CPU-bound threads...
+(edf-deadline) 0 deadline misses in 50 periods.
+(edf-deadline) end
+EOF
+pass;
@@ -0,0 +1,87 @@
+/* Exercises an object cache with a constructor.
+
+   Allocates enough objects to fill several slabs, checks that
+   they are aligned, constructed and do not overlap, then frees
+   every other one and allocates as many again.  Those have to
+   come from the freed slots, still in the state they were freed
+   in, without the constructor running again. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+
+/* Number of objects to allocate. */
+#define OBJ_CNT 200
+
+/* Object alignment. */
+#define OBJ_ALIGN 32
+
+/* Value the constructor leaves in `state'. */
+#define CTOR_MAGIC 0x5ab1e
+
+struct object
+  {
+    int state;                  /* CTOR_MAGIC while free. */
+    int id;                     /* Set while allocated. */
+    char pad[92];               /* Make the size awkward. */
+  };
+
+static int ctor_cnt;
+
+static void
+object_ctor (void *obj_)
+{
+  struct object *obj = obj_;
+  obj->state = CTOR_MAGIC;
+  ctor_cnt++;
+}
+
+void
+test_slab_cache (void)
+{
+  static struct object *objs[OBJ_CNT];
+  struct kmem_cache *cache;
+  int ctor_before;
+  int i;
+
+  cache = kmem_cache_create ("test", sizeof (struct object), OBJ_ALIGN,
+                             object_ctor);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("allocation %d failed", i);
+      if ((uintptr_t) objs[i] % OBJ_ALIGN != 0)
+        fail ("object %d at %p is misaligned", i, objs[i]);
+      if (objs[i]->state != CTOR_MAGIC)
+        fail ("object %d was not constructed", i);
+      objs[i]->id = i;
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    if (objs[i]->id != i)
+      fail ("object %d was overwritten", i);
+  msg ("Allocated %d constructed objects.", OBJ_CNT);
+
+  /* Freeing every other object leaves no slab empty, so no slab
+     is given back and reallocating needs no new ones. */
+  ctor_before = ctor_cnt;
+  for (i = 0; i < OBJ_CNT; i += 2)
+    kmem_cache_free (cache, objs[i]);
+  for (i = 0; i < OBJ_CNT; i += 2)
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL || objs[i]->state != CTOR_MAGIC)
+        fail ("reallocated object %d is not in its constructed state", i);
+    }
+  if (ctor_cnt != ctor_before)
+    fail ("constructor ran %d more times", ctor_cnt - ctor_before);
+  msg ("Reallocated %d objects without constructing them again.",
+       OBJ_CNT / 2);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+  msg ("Freed all objects.");
+}
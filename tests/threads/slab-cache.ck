@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) Allocated 200 constructed objects.
+(slab-cache) Reallocated 100 objects without constructing them again.
+(slab-cache) Freed all objects.
+(slab-cache) end
+EOF
+pass;
@@ -0,0 +1,153 @@
+/* Measures the throughput of memcpy(), memset(), memcmp(), and
+   strlen() on blocks of several sizes, next to that of the simple
+   byte-at-a-time loops they replace.
+
+   Results depend on the host, so beyond checking that the library
+   functions agree with the loops, the test only reports them for
+   comparison between kernels. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Times to repeat each operation. */
+#define REPS 1000
+
+static const size_t sizes[] = {16, 64, 256, 1024, 4096};
+
+static void byte_copy (void *, const void *, size_t);
+static void byte_set (void *, int, size_t);
+static int byte_cmp (const void *, const void *, size_t);
+static size_t byte_strlen (const char *);
+static int64_t rate (size_t size, int64_t start);
+
+void
+test_string_bench (void) 
+{
+  char *a = palloc_get_page (PAL_ASSERT);
+  char *b = palloc_get_page (PAL_ASSERT);
+  volatile size_t sink = 0;
+  size_t i;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++) 
+    {
+      size_t size = sizes[i];
+      int64_t copy, copy_slow, set, set_slow, cmp, cmp_slow, len, len_slow;
+      int64_t start;
+      int n;
+
+      ASSERT (size <= PGSIZE);
+
+      start = timer_ns ();
+      for (n = 0; n < REPS; n++)
+        memset (a, n, size);
+      set = rate (size, start);
+      start = timer_ns ();
+      for (n = 0; n < REPS; n++)
+        byte_set (b, n, size);
+      set_slow = rate (size, start);
+      if (byte_cmp (a, b, size))
+        fail ("memset() of %zu bytes differs from byte loop", size);
+
+      for (n = 0; n < (int) size; n++)
+        a[n] = n * 7;
+      start = timer_ns ();
+      for (n = 0; n < REPS; n++)
+        memcpy (b, a, size);
+      copy = rate (size, start);
+      if (byte_cmp (a, b, size))
+        fail ("memcpy() of %zu bytes differs from source", size);
+      start = timer_ns ();
+      for (n = 0; n < REPS; n++)
+        byte_copy (b, a, size);
+      copy_slow = rate (size, start);
+
+      start = timer_ns ();
+      for (n = 0; n < REPS; n++)
+        sink += memcmp (a, b, size);
+      cmp = rate (size, start);
+      start = timer_ns ();
+      for (n = 0; n < REPS; n++)
+        sink += byte_cmp (a, b, size);
+      cmp_slow = rate (size, start);
+      b[size - 1]++;
+      if (memcmp (a, b, size) != byte_cmp (a, b, size))
+        fail ("memcmp() of %zu bytes differs from byte loop", size);
+
+      memset (a, 'x', size - 1);
+      a[size - 1] = '\0';
+      start = timer_ns ();
+      for (n = 0; n < REPS; n++)
+        sink += strlen (a);
+      len = rate (size, start);
+      start = timer_ns ();
+      for (n = 0; n < REPS; n++)
+        sink += byte_strlen (a);
+      len_slow = rate (size, start);
+      if (strlen (a + 3) != byte_strlen (a + 3))
+        fail ("strlen() of %zu bytes differs from byte loop", size - 4);
+
+      msg ("%zu bytes: memcpy %lld MB/s (%lld), memset %lld MB/s (%lld), "
+           "memcmp %lld MB/s (%lld), strlen %lld MB/s (%lld).",
+           size, copy, copy_slow, set, set_slow, cmp, cmp_slow,
+           len, len_slow);
+    }
+  msg ("Rates in parentheses are for byte loops.");
+
+  palloc_free_page (a);
+  palloc_free_page (b);
+}
+
+/* Returns the rate, in MB/s, at which REPS operations on SIZE
+   bytes each ran if they started at START, in timer_ns() time. */
+static int64_t
+rate (size_t size, int64_t start) 
+{
+  int64_t ns = timer_ns () - start;
+  return (int64_t) size * REPS * 1000 / (ns > 0 ? ns : 1);
+}
+
+static void
+byte_copy (void *dst_, const void *src_, size_t size) 
+{
+  char *dst = dst_;
+  const char *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+static void
+byte_set (void *dst_, int value, size_t size) 
+{
+  char *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+}
+
+static int
+byte_cmp (const void *a_, const void *b_, size_t size) 
+{
+  const unsigned char *a = a_;
+  const unsigned char *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+static size_t
+byte_strlen (const char *string) 
+{
+  const char *p;
+
+  for (p = string; *p != '\0'; p++)
+    continue;
+  return p - string;
+}
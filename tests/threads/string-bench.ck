@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "missing begin message\n"
+  if !grep ($_ eq '(string-bench) begin', @output);
+fail "missing end message\n"
+  if !grep ($_ eq '(string-bench) end', @output);
+
+foreach my $size (16, 64, 256, 1024, 4096) {
+    my ($line) = grep (/^\(string-bench\) $size bytes: memcpy \d+ MB\/s/,
+		       @output);
+    fail "missing rates for $size bytes\n" if !defined $line;
+    $line =~ s/^\(string-bench\) //;
+    print "$line\n";
+}
+pass;
@@ -0,0 +1,85 @@
+/* Measures context switch throughput.
+
+   Two threads bounce a pair of semaphores back and forth, so
+   that every sema_up() hands the CPU directly to the other
+   thread, and we count how many switches happen in a fixed
+   number of timer ticks.  The count depends on the host, and no
+   figure for any other kernel is kept to compare it with, so the
+   test only checks that switching works at all and prints the
+   rate as information. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of timer ticks to run for. */
+#define BENCH_TICKS 100
+
+static thread_func ping_thread, pong_thread;
+
+static struct semaphore ping_sema, pong_sema, done_sema;
+static volatile bool stop;
+static int64_t rounds;
+
+void
+test_switch_pingpong (void) 
+{
+  int64_t switches;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&ping_sema, 0);
+  sema_init (&pong_sema, 0);
+  sema_init (&done_sema, 0);
+
+  /* Both threads outrank us, so while they run we stay out of
+     the way, and each sema_up() switches straight to the peer. */
+  thread_create ("pong", PRI_DEFAULT + 1, pong_thread, NULL);
+  thread_create ("ping", PRI_DEFAULT + 1, ping_thread, NULL);
+  sema_down (&done_sema);
+
+  switches = rounds * 2;
+  msg ("Ping-pong finished.");
+  if (rounds == 0)
+    fail ("no switches in %d ticks", BENCH_TICKS);
+  msg ("%lld context switches in %d ticks.", switches, BENCH_TICKS);
+  msg ("%lld switches per tick.", switches / BENCH_TICKS);
+}
+
+static void
+ping_thread (void *aux UNUSED) 
+{
+  int64_t start = timer_ticks ();
+
+  /* Wait for a tick boundary so that we measure whole ticks. */
+  while (timer_ticks () == start)
+    continue;
+  start = timer_ticks ();
+
+  while (timer_elapsed (start) < BENCH_TICKS)
+    {
+      sema_up (&pong_sema);
+      sema_down (&ping_sema);
+      rounds++;
+    }
+
+  stop = true;
+  sema_up (&pong_sema);
+  sema_up (&done_sema);
+}
+
+static void
+pong_thread (void *aux UNUSED) 
+{
+  for (;;)
+    {
+      sema_down (&pong_sema);
+      if (stop)
+        break;
+      sema_up (&ping_sema);
+    }
+}
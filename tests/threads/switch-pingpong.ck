@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "missing begin message\n"
+  if !grep ($_ eq '(switch-pingpong) begin', @output);
+fail "missing end message\n"
+  if !grep ($_ eq '(switch-pingpong) end', @output);
+fail "ping-pong threads never finished\n"
+  if !grep ($_ eq '(switch-pingpong) Ping-pong finished.', @output);
+
+my ($switches) = map (/^\(switch-pingpong\) (\d+) context switches in \d+ ticks\.$/,
+		      @output);
+fail "missing context switch count\n" if !defined $switches;
+fail "no context switches were counted\n" if $switches == 0;
+
+my ($rate) = map (/^\(switch-pingpong\) (\d+) switches per tick\.$/, @output);
+fail "missing switch rate\n" if !defined $rate;
+print "$rate context switches per tick.\n";
+pass;
@@ -19,10 +19,19 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_rwlock;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_switch_pingpong;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_nice_2;
+extern test_func test_edf_deadline;
+extern test_func test_slab_cache;
+extern test_func test_bitmap_scan;
+extern test_func test_bitmap_bench;
+extern test_func test_string_bench;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -37,5 +46,7 @@ void msg (const char *, ...);
 void fail (const char *, ...);
 void pass (void);
 
+void fair_spin (int thread_cnt, int nice_min, int nice_step);
+
 #endif /* tests/threads/tests.h */
 
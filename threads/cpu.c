@@ -0,0 +1,216 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/vaddr.h"
+
+/* Processors found by cpu_init(), the BSP first. */
+struct cpu cpus[CPU_MAX];
+int cpu_cnt;
+
+/* Physical address of the local APICs' registers. */
+uint64_t lapic_base;
+
+/* Physical memory mapped by the loader's page tables (see
+   start.S).  Firmware tables are read before paging_init()
+   replaces them, and only where the loader mapped them.  With
+   more memory than this, QEMU puts the ACPI tables above it and
+   we do not look for them: nothing but the count printed at boot
+   depends on what cpu_init() finds. */
+#define ACPI_MAP_LIMIT (256 * 1024 * 1024)
+
+/* ACPI root system description pointer. */
+struct rsdp
+{
+    char signature[8];  /* "RSD PTR ". */
+    uint8_t checksum;
+    char oem_id[6];
+    uint8_t revision;   /* 0 for ACPI 1.0, 2 for later versions. */
+    uint32_t rsdt;      /* Physical address of the RSDT. */
+    uint32_t length;    /* ACPI 2.0 and later only, as are... */
+    uint64_t xsdt;      /* ...the XSDT's address... */
+    uint8_t ext_checksum; /* ...and the extended checksum. */
+    uint8_t reserved[3];
+} __attribute__((packed));
+
+/* Header common to all ACPI system description tables. */
+struct sdt_header
+{
+    char signature[4];
+    uint32_t length;    /* Including this header. */
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed));
+
+/* Multiple APIC description table, "APIC". */
+struct madt
+{
+    struct sdt_header header;
+    uint32_t lapic_base; /* Physical address of local APICs. */
+    uint32_t flags;
+    uint8_t entries[];   /* Variable-length entries follow. */
+} __attribute__((packed));
+
+/* MADT entry types used here. */
+#define MADT_LAPIC 0          /* A processor's local APIC. */
+#define MADT_LAPIC_OVERRIDE 5 /* 64-bit local APIC address. */
+
+/* Flag in a MADT_LAPIC entry. */
+#define MADT_LAPIC_ENABLED 0x1
+
+static const struct rsdp *find_rsdp(void);
+static const struct sdt_header *find_table(const struct rsdp *, const char *signature);
+static const struct sdt_header *map_table(uint64_t paddr);
+static const void *acpi_ptov(uint64_t paddr, size_t size);
+static bool checksum_ok(const void *, size_t);
+static void parse_madt(const struct madt *);
+
+/* Enumerates the machine's processors.  Must be called before
+   palloc_init(), which hands out the ACPI reclaimable memory the
+   tables are in, and before paging_init(); see ACPI_MAP_LIMIT. */
+void cpu_init(void)
+{
+    const struct rsdp *rsdp;
+    const struct madt *madt = NULL;
+
+    lapic_base = 0xfee00000;
+    rsdp = find_rsdp();
+    if (rsdp != NULL)
+        madt = (const struct madt *)find_table(rsdp, "APIC");
+    if (madt != NULL)
+        parse_madt(madt);
+
+    /* Without a MADT, there is only the processor we are on. */
+    if (cpu_cnt == 0)
+        cpu_cnt = 1;
+    cpus[0].online = true;
+
+    printf("%d CPU%s found, 1 online\n", cpu_cnt, cpu_cnt != 1 ? "s" : "");
+}
+
+/* Records each enabled processor in MADT, the BSP first.  The BSP
+   is the processor we are running on; we take it to be the first
+   one listed, which is what ACPI firmware does in practice. */
+static void parse_madt(const struct madt *madt)
+{
+    const uint8_t *p = madt->entries;
+    const uint8_t *end = (const uint8_t *)madt + madt->header.length;
+
+    lapic_base = madt->lapic_base;
+    while (p + 2 <= end && p[1] >= 2 && p + p[1] <= end)
+    {
+        if (p[0] == MADT_LAPIC && p[1] >= 8)
+        {
+            uint32_t flags;
+
+            memcpy(&flags, p + 4, sizeof flags);
+            if (flags & MADT_LAPIC_ENABLED)
+            {
+                if (cpu_cnt < CPU_MAX)
+                {
+                    cpus[cpu_cnt].id = cpu_cnt;
+                    cpus[cpu_cnt].apic_id = p[3];
+                    cpu_cnt++;
+                }
+                else
+                    printf("cpu: more than %d CPUs, ignoring APIC ID %u\n", CPU_MAX, p[3]);
+            }
+        }
+        else if (p[0] == MADT_LAPIC_OVERRIDE && p[1] >= 12)
+            memcpy(&lapic_base, p + 4, sizeof lapic_base);
+        p += p[1];
+    }
+}
+
+/* Searches the places the ACPI specification allows for the RSDP:
+   the first kilobyte of the extended BIOS data area and the BIOS
+   ROM between 0xe0000 and 0xfffff.  Returns it, or a null pointer
+   if there is none. */
+static const struct rsdp *find_rsdp(void)
+{
+    uint64_t ebda = (uint64_t)*(const uint16_t *)ptov(0x40e) << 4;
+    const uint64_t ranges[2][2] = {{ebda, ebda + 1024}, {0xe0000, 0x100000}};
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        uint64_t pa;
+
+        if (ranges[i][0] == 0)
+            continue;
+        for (pa = ranges[i][0]; pa + 20 <= ranges[i][1]; pa += 16)
+        {
+            const struct rsdp *rsdp = ptov(pa);
+
+            if (!memcmp(rsdp->signature, "RSD PTR ", 8) && checksum_ok(rsdp, 20))
+                return rsdp;
+        }
+    }
+    return NULL;
+}
+
+/* Returns the system description table with the given SIGNATURE
+   listed in RSDP's root table, or a null pointer if there is none
+   or it cannot be read. */
+static const struct sdt_header *find_table(const struct rsdp *rsdp, const char *signature)
+{
+    bool xsdt = rsdp->revision >= 2 && rsdp->xsdt != 0;
+    const struct sdt_header *root = map_table(xsdt ? rsdp->xsdt : rsdp->rsdt);
+    size_t entry_size = xsdt ? 8 : 4;
+    size_t cnt, i;
+
+    if (root == NULL)
+        return NULL;
+
+    cnt = (root->length - sizeof *root) / entry_size;
+    for (i = 0; i < cnt; i++)
+    {
+        const uint8_t *entry = (const uint8_t *)(root + 1) + i * entry_size;
+        uint64_t pa = 0;
+        const struct sdt_header *t;
+
+        memcpy(&pa, entry, entry_size);
+        t = map_table(pa);
+        if (t != NULL && !memcmp(t->signature, signature, 4))
+            return t;
+    }
+    return NULL;
+}
+
+/* Returns the system description table at physical address
+   PADDR, or a null pointer if it is not mapped or is corrupt. */
+static const struct sdt_header *map_table(uint64_t paddr)
+{
+    const struct sdt_header *t = acpi_ptov(paddr, sizeof *t);
+
+    if (t == NULL || t->length < sizeof *t || acpi_ptov(paddr, t->length) == NULL || !checksum_ok(t, t->length))
+        return NULL;
+    return t;
+}
+
+/* Returns the kernel virtual address of the SIZE bytes of firmware
+   data at physical address PADDR, or a null pointer if they are not
+   all mapped. */
+static const void *acpi_ptov(uint64_t paddr, size_t size)
+{
+    if (paddr == 0 || paddr >= ACPI_MAP_LIMIT || size > ACPI_MAP_LIMIT - paddr)
+        return NULL;
+    return ptov(paddr);
+}
+
+/* Returns true if the SIZE bytes at P sum to zero, as the bytes of
+   every ACPI table do. */
+static bool checksum_ok(const void *p_, size_t size)
+{
+    const uint8_t *p = p_;
+    uint8_t sum = 0;
+
+    while (size-- > 0)
+        sum += *p++;
+    return sum == 0;
+}
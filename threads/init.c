@@ -1,5 +1,6 @@
 #include "threads/init.h"
 #include <console.h>
+#include <intrinsic.h>
 #include <debug.h>
 #include <limits.h>
 #include <random.h>
@@ -13,6 +14,7 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -20,7 +22,10 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -38,6 +43,10 @@
 #include "filesys/fsutil.h"
 #endif
 
+/* Large page sizes, for the direct map. */
+#define PAGE_2M (1ULL << PDXSHIFT)
+#define PAGE_1G (1ULL << PDPESHIFT)
+
 /* Page-map-level-4 with kernel mappings only. */
 uint64_t *base_pml4;
 
@@ -53,6 +62,8 @@ bool thread_tests;
 
 static void bss_init(void);
 static void paging_init(uint64_t mem_end);
+static bool paging_small_only(uint64_t pa, uint64_t size);
+static uint64_t *paging_entry(uint64_t *pml4, uint64_t va, int level);
 
 static char **read_command_line(void);
 static char **parse_options(char **argv);
@@ -81,6 +92,10 @@ int main(void)
 	thread_init();
 	console_init();
 
+	/* Find the other processors, before palloc_init() reuses the
+	   memory the firmware's tables are in. */
+	cpu_init();
+
 	/* Initialize memory system. */
 	mem_end = palloc_init();
 	malloc_init();
@@ -92,6 +107,7 @@ int main(void)
 #endif
 
 	/* Initialize interrupt handlers. */
+	workqueue_init();
 	intr_init();
 	timer_init();
 	kbd_init();
@@ -102,6 +118,7 @@ int main(void)
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start();
+	workqueue_start();
 	serial_init_queue();
 	timer_calibrate();
 
@@ -142,31 +159,109 @@ bss_init(void)
 
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
+ * Memory is mapped with 2 MiB pages, or 1 GiB pages where the
+ * CPU has them, except where paging_small_only() says not to,
+ * which saves page tables and TLB entries.
  * Points base_pml4 to the pml4 it creates. */
 static void
 paging_init(uint64_t mem_end)
 {
 	uint64_t *pml4, *pte;
+	uint32_t regs[4];
+	bool gb_pages;
+	size_t cnt[3] = {0, 0, 0};
 	int perm;
 	pml4 = base_pml4 = palloc_get_page(PAL_ASSERT | PAL_ZERO);
 
+	/* 1 GiB pages are optional (CPUID.80000001H:EDX[26]). */
+	cpuid(0x80000000, regs);
+	gb_pages = false;
+	if (regs[0] >= 0x80000001)
+	{
+		cpuid(0x80000001, regs);
+		gb_pages = (regs[3] & (1 << 26)) != 0;
+	}
+
 	extern char start, _end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
-	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE)
+	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end],
+	//   with the largest pages that fit.
+	for (uint64_t pa = 0; pa < mem_end;)
 	{
 		uint64_t va = (uint64_t)ptov(pa);
 
-		perm = PTE_P | PTE_W;
-		if ((uint64_t)&start <= va && va < (uint64_t)&_end_kernel_text)
-			perm &= ~PTE_W;
-
-		if ((pte = pml4e_walk(pml4, va, 1)) != NULL)
-			*pte = pa | perm;
+		if (gb_pages && pa % PAGE_1G == 0 && mem_end - pa >= PAGE_1G && !paging_small_only(pa, PAGE_1G))
+		{
+			*paging_entry(pml4, va, 1) = pa | PTE_P | PTE_W | PTE_PS;
+			pa += PAGE_1G;
+			cnt[0]++;
+		}
+		else if (pa % PAGE_2M == 0 && mem_end - pa >= PAGE_2M && !paging_small_only(pa, PAGE_2M))
+		{
+			*paging_entry(pml4, va, 2) = pa | PTE_P | PTE_W | PTE_PS;
+			pa += PAGE_2M;
+			cnt[1]++;
+		}
+		else
+		{
+			perm = PTE_P | PTE_W;
+			if ((uint64_t)&start <= va && va < (uint64_t)&_end_kernel_text)
+				perm &= ~PTE_W;
+
+			if ((pte = pml4e_walk(pml4, va, 1)) != NULL)
+				*pte = pa | perm;
+			pa += PGSIZE;
+			cnt[2]++;
+		}
 	}
 
 	// reload cr3
 	pml4_activate(0);
+	pcid_init();
+
+	printf("Kernel mapped with %zu 1 GiB, %zu 2 MiB, and %zu 4 KiB pages\n",
+		   cnt[0], cnt[1], cnt[2]);
+}
+
+/* Returns true if the SIZE bytes of physical memory starting at PA
+   have to be mapped with 4 KiB pages: if they include kernel text,
+   which is mapped read-only, the first megabyte, or anything the
+   memory map does not describe as RAM.  Firmware areas, holes and
+   device memory may have memory types that differ from the RAM
+   around them, and a large page that spans memory types is
+   handled as uncacheable. */
+static bool
+paging_small_only(uint64_t pa, uint64_t size)
+{
+	extern char start, _end_kernel_text;
+	uint64_t text_start = vtop(&start);
+	uint64_t text_end = vtop(&_end_kernel_text);
+
+	return pa < 1024 * 1024 || (pa < text_end && text_start < pa + size)
+		   || !palloc_is_ram(pa, size);
+}
+
+/* Returns the entry for kernel virtual address VA in the page
+   directory pointer table, if LEVEL is 1, or the page directory,
+   if LEVEL is 2, that PML4 leads to, creating tables on the way
+   as needed. */
+static uint64_t *
+paging_entry(uint64_t *pml4, uint64_t va, int level)
+{
+	const unsigned idx[3] = {PML4(va), PDPE(va), PDX(va)};
+	uint64_t *table = pml4;
+	int i;
+
+	for (i = 0; i < level; i++)
+	{
+		uint64_t *e = &table[idx[i]];
+
+		ASSERT(!(*e & PTE_PS));
+		if (!(*e & PTE_P))
+			*e = vtop(palloc_get_page(PAL_ASSERT | PAL_ZERO)) | PTE_P | PTE_W;
+		table = ptov(PTE_ADDR(*e));
+	}
+	return &table[idx[level]];
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -227,6 +322,12 @@ parse_options(char **argv)
 			random_init(atoi(value));
 		else if (!strcmp(name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp(name, "-cfs"))
+			thread_cfs = true;
+		else if (!strcmp(name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp(name, "-lockprof"))
+			lock_profiling = true;
 #ifdef USERPROG
 		else if (!strcmp(name, "-ul"))
 			user_page_limit = atoi(value);
@@ -237,6 +338,9 @@ parse_options(char **argv)
 			PANIC("unknown option `%s' (use -h for help)", name);
 	}
 
+	if (thread_mlfqs && thread_cfs)
+		PANIC("-mlfqs and -cfs are mutually exclusive");
+
 	return argv;
 }
 
@@ -339,6 +443,9 @@ usage(void)
 		   "  -f                 Format file system disk during startup.\n"
 		   "  -rs=SEED           Set random number seed to SEED.\n"
 		   "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+		   "  -cfs               Use completely fair scheduler.\n"
+		   "  -tickless          Stop the periodic timer tick while idle.\n"
+		   "  -lockprof          Report lock contention at shutdown.\n"
 #ifdef USERPROG
 		   "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -368,6 +475,11 @@ print_stats(void)
 {
 	timer_print_stats();
 	thread_print_stats();
+	palloc_print_stats();
+	kmem_print_stats();
+	malloc_print_stats();
+	lock_print_stats();
+	workqueue_print_stats();
 #ifdef FILESYS
 	disk_print_stats();
 #endif
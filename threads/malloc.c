@@ -11,9 +11,12 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
+   The size of each request, in bytes, is rounded up to the next
+   size class and assigned to the "descriptor" that manages blocks
+   of that size.  The size classes are the powers of 2 and the
+   sizes halfway between them (16, 24, 32, 48, 64, 96, ...), so
+   that rounding wastes less than a third of any block instead of
+   up to half of it.  The descriptor keeps a list of free blocks.  If
    the free list is nonempty, one of its blocks is used to
    satisfy the request.
 
@@ -28,8 +31,8 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
+   We can't handle blocks bigger than 1.5 kB using this scheme,
+   because fewer than two of them fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
@@ -40,6 +43,11 @@ struct desc {
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+
+	/* Statistics, protected by `lock'. */
+	size_t arena_cnt;           /* Arenas held. */
+	size_t in_use;              /* Blocks allocated. */
+	size_t peak;                /* Most blocks allocated at once. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -58,9 +66,16 @@ struct block {
 };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[16];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Pages held by the heap, in arenas and in big blocks. */
+static struct spinlock pages_lock;
+static size_t heap_pages, heap_peak;
+static size_t big_pages, big_peak;
+
+static void count_pages (long arena_pages, long block_pages);
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
 
@@ -69,7 +84,11 @@ void
 malloc_init (void) {
 	size_t block_size;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+	/* Each step alternately multiplies by 3/2 and by 4/3. */
+	for (block_size = 16;
+			(PGSIZE - sizeof (struct arena)) / block_size >= 2;
+			block_size += block_size & (block_size - 1) ? block_size / 3
+			: block_size / 2) {
 		struct desc *d = &descs[desc_cnt++];
 		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
 		d->block_size = block_size;
@@ -77,6 +96,7 @@ malloc_init (void) {
 		list_init (&d->free_list);
 		lock_init (&d->lock);
 	}
+	spin_lock_init (&pages_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -109,6 +129,7 @@ malloc (size_t size) {
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
+		count_pages (0, page_cnt);
 		return a + 1;
 	}
 
@@ -133,12 +154,16 @@ malloc (size_t size) {
 			struct block *b = arena_to_block (a, i);
 			list_push_back (&d->free_list, &b->free_elem);
 		}
+		d->arena_cnt++;
+		count_pages (1, 0);
 	}
 
 	/* Get a block from free list and return it. */
 	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
 	a = block_to_arena (b);
 	a->free_cnt--;
+	if (++d->in_use > d->peak)
+		d->peak = d->in_use;
 	lock_release (&d->lock);
 	return b;
 }
@@ -217,6 +242,7 @@ free (void *p) {
 
 			/* Add block to free list. */
 			list_push_front (&d->free_list, &b->free_elem);
+			d->in_use--;
 
 			/* If the arena is now entirely unused, free it. */
 			if (++a->free_cnt >= d->blocks_per_arena) {
@@ -228,17 +254,51 @@ free (void *p) {
 					list_remove (&b->free_elem);
 				}
 				palloc_free_page (a);
+				d->arena_cnt--;
+				count_pages (-1, 0);
 			}
 
 			lock_release (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
+			count_pages (0, -(long) a->free_cnt);
 			palloc_free_multiple (a, a->free_cnt);
 			return;
 		}
 	}
 }
 
+/* Prints statistics for the heap and for each size class that
+   has been used. */
+void
+malloc_print_stats (void) {
+	struct desc *d;
+
+	printf ("Heap: %zu pages held (peak %zu), %zu in big blocks (peak %zu)\n",
+			heap_pages, heap_peak, big_pages, big_peak);
+	for (d = descs; d < descs + desc_cnt; d++)
+		if (d->peak > 0)
+			printf ("Heap: %4zu-byte blocks: %zu in use (%zu bytes, peak %zu), "
+					"%zu arenas\n", d->block_size, d->in_use,
+					d->in_use * d->block_size, d->peak, d->arena_cnt);
+}
+
+/* Adds ARENA_PAGES pages in arenas and BLOCK_PAGES pages in big
+   blocks, either of which may be negative, to the heap's page
+   counts. */
+static void
+count_pages (long arena_pages, long block_pages) {
+	enum intr_level old_level = spin_lock_irqsave (&pages_lock);
+
+	heap_pages += arena_pages + block_pages;
+	if (heap_pages > heap_peak)
+		heap_peak = heap_pages;
+	big_pages += block_pages;
+	if (big_pages > big_peak)
+		big_peak = big_pages;
+	spin_unlock_irqrestore (&pages_lock, old_level);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
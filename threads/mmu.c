@@ -1,13 +1,43 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers (PCIDs).
+
+   Once CR4.PCIDE is set, the TLB tags its entries with the PCID in
+   the low 12 bits of CR3, and loading CR3 with bit 63 set keeps
+   the entries of every PCID instead of flushing them.  Switching
+   back to an address space that still has its PCID then costs no
+   TLB refills.
+
+   Each processor hands out its PCIDs round robin to the page maps
+   it activates.  PCID 0 is base_pml4's, which only has kernel
+   mappings, and those never change.  Taking a PCID from another
+   page map flushes whatever that map left in the TLB, by loading
+   CR3 without bit 63.  A page map whose entries change while it is
+   not loaded has stale TLB entries under its PCID, so it gives up
+   its PCID and gets a fresh one, with a flush, the next time it is
+   activated. */
+#define PCID_CNT 32
+#define CR3_NOFLUSH (1ULL << 63)
+#define CR4_PCIDE (1 << 17)
+
+static bool pcid_enabled;
+static struct spinlock pcid_lock;
+static uint64_t *pcid_owner[CPU_MAX][PCID_CNT]; /* Null if free. */
+static unsigned pcid_next[CPU_MAX];              /* Next PCID to hand out. */
+
+static void pcid_forget (uint64_t *pml4);
+static void tlb_invalidate (uint64_t *pml4, const void *va);
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
@@ -22,7 +52,8 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 					return NULL;
 			} else
 				return NULL;
-		}
+		} else if (pdp[idx] & PTE_PS)
+			return NULL;
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
 	return NULL;
@@ -45,7 +76,8 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 					return NULL;
 			} else
 				return NULL;
-		}
+		} else if (pdpe[idx] & PTE_PS)
+			return NULL;
 		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
@@ -60,7 +92,9 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
  * If PML4E does not have a page table for VADDR, behavior depends
  * on CREATE.  If CREATE is true, then a new page table is
  * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. */
+ * pointer is returned.
+ * Kernel addresses mapped by large pages have no page table
+ * entry, so a null pointer is returned for them, too. */
 
 /* 페이지 맵 레벨 4, pml4에서 가상 주소 VADDR에 대한 페이지 테이블 엔트리의 주소를 반환합니다.
 
@@ -106,61 +140,144 @@ pml4_create (void) {
 	return pml4;
 }
 
+/* Page table walks over a range of virtual addresses.
+ *
+ * Each level visits only the entries whose regions overlap the
+ * range, [START, LAST] with LAST inclusive so that the range can
+ * reach the top of the address space, and descends only into
+ * present entries, so that an address space costs time in
+ * proportion to the page tables it has rather than to the size of
+ * the range.  BASE is the first address that the table at hand
+ * maps.  The page tables pass on runs of consecutive present
+ * PTEs. */
+
+/* Size of the address space a PML4 maps. */
+#define VA_SPAN (1ULL << (PML4SHIFT + 9))
+
+/* Returns the index of the first entry of a table, mapping BASE
+ * onward in regions of 1 << SHIFT bytes, that START reaches. */
+static inline unsigned
+first_idx (uint64_t base, uint64_t start, unsigned shift) {
+	return start > base ? ((start - base) >> shift) : 0;
+}
+
+/* Returns the index of the last entry of a table, mapping BASE
+ * onward in regions of 1 << SHIFT bytes, that LAST reaches. */
+static inline unsigned
+last_idx (uint64_t base, uint64_t last, unsigned shift) {
+	uint64_t idx = (last - base) >> shift;
+	return idx < 512 ? idx : 511;
+}
+
 static bool
-pt_for_each (uint64_t *pt, pte_for_each_func *func, void *aux,
-		unsigned pml4_index, unsigned pdp_index, unsigned pdx_index) {
-	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
-		uint64_t *pte = &pt[i];
-		if (((uint64_t) *pte) & PTE_P) {
-			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
-								 ((uint64_t) pdp_index << PDPESHIFT) |
-								 ((uint64_t) pdx_index << PDXSHIFT) |
-								 ((uint64_t) i << PTXSHIFT));
-			if (!func (pte, va, aux))
-				return false;
+pt_for_each (uint64_t *pt, uint64_t base, uint64_t start, uint64_t last,
+		pte_batch_func *func, void *aux) {
+	unsigned i = first_idx (base, start, PTXSHIFT);
+	unsigned end = last_idx (base, last, PTXSHIFT) + 1;
+
+	while (i < end) {
+		unsigned j;
+
+		if (!(pt[i] & PTE_P)) {
+			i++;
+			continue;
 		}
+		for (j = i + 1; j < end && (pt[j] & PTE_P); j++)
+			continue;
+		if (!func (&pt[i], (void *) (base + ((uint64_t) i << PTXSHIFT)),
+					j - i, aux))
+			return false;
+		i = j;
 	}
 	return true;
 }
 
 static bool
-pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
-		unsigned pml4_index, unsigned pdp_index) {
-	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
-		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
-					pml4_index, pdp_index, i))
+pgdir_for_each (uint64_t *pd, uint64_t base, uint64_t start, uint64_t last,
+		pte_batch_func *func, void *aux) {
+	unsigned end = last_idx (base, last, PDXSHIFT);
+
+	for (unsigned i = first_idx (base, start, PDXSHIFT); i <= end; i++)
+		if ((pd[i] & (PTE_P | PTE_PS)) == PTE_P)
+			if (!pt_for_each (ptov (PTE_ADDR (pd[i])),
+					base + ((uint64_t) i << PDXSHIFT), start, last, func, aux))
 				return false;
-	}
 	return true;
 }
 
 static bool
-pdp_for_each (uint64_t *pdp,
-		pte_for_each_func *func, void *aux, unsigned pml4_index) {
-	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
-		uint64_t *pde = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pde) & PTE_P)
-			if (!pgdir_for_each ((uint64_t *) PTE_ADDR (pde), func,
-					 aux, pml4_index, i))
+pdp_for_each (uint64_t *pdp, uint64_t base, uint64_t start, uint64_t last,
+		pte_batch_func *func, void *aux) {
+	unsigned end = last_idx (base, last, PDPESHIFT);
+
+	for (unsigned i = first_idx (base, start, PDPESHIFT); i <= end; i++)
+		if ((pdp[i] & (PTE_P | PTE_PS)) == PTE_P)
+			if (!pgdir_for_each (ptov (PTE_ADDR (pdp[i])),
+					base + ((uint64_t) i << PDPESHIFT), start, last, func, aux))
 				return false;
-	}
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each run of consecutive available pte entries in
+ * PML4 that map pages from START up to END, exclusive: FUNC gets
+ * the run's first pte, the virtual address it maps, and the
+ * number of ptes in the run, which do not cross a page table.
+ * Stops and returns false as soon as FUNC returns false, and
+ * returns true otherwise.
+ * Large pages, which have no pte, are skipped. */
 bool
-pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
-	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
-		uint64_t *pdpe = ptov((uint64_t *) pml4[i]);
-		if (((uint64_t) pdpe) & PTE_P)
-			if (!pdp_for_each ((uint64_t *) PTE_ADDR (pdpe), func, aux, i))
+pml4_for_each_batch (uint64_t *pml4, void *start, void *end,
+		pte_batch_func *func, void *aux) {
+	uint64_t first = (uint64_t) start;
+	uint64_t last = (uint64_t) end - 1;
+
+	if ((uint64_t) end <= first || first >= VA_SPAN)
+		return true;
+	if (last >= VA_SPAN)
+		last = VA_SPAN - 1;
+
+	for (unsigned i = first_idx (0, first, PML4SHIFT); i <= last_idx (0, last, PML4SHIFT); i++)
+		if (pml4[i] & PTE_P)
+			if (!pdp_for_each (ptov (PTE_ADDR (pml4[i])),
+					(uint64_t) i << PML4SHIFT, first, last, func, aux))
 				return false;
-	}
 	return true;
 }
 
+/* A pte_for_each_func and its argument, for for_each_adapter(). */
+struct for_each_aux {
+	pte_for_each_func *func;
+	void *aux;
+};
+
+/* Calls the pte_for_each_func in AUX_ on each of the CNT ptes
+ * starting at PTES. */
+static bool
+for_each_adapter (uint64_t *ptes, void *va, size_t cnt, void *aux_) {
+	struct for_each_aux *aux = aux_;
+
+	for (size_t i = 0; i < cnt; i++)
+		if (!aux->func (&ptes[i], (uint8_t *) va + i * PGSIZE, aux->aux))
+			return false;
+	return true;
+}
+
+/* Apply FUNC to each available pte entries that map pages from
+ * START up to END, exclusive. */
+bool
+pml4_for_each_range (uint64_t *pml4, void *start, void *end,
+		pte_for_each_func *func, void *aux) {
+	struct for_each_aux fa = { func, aux };
+	return pml4_for_each_batch (pml4, start, end, for_each_adapter, &fa);
+}
+
+/* Apply FUNC to each available pte entries including kernel's.
+ * Large pages, which have no pte, are skipped. */
+bool
+pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
+	return pml4_for_each_range (pml4, NULL, (void *) VA_SPAN, func, aux);
+}
+
 static void
 pt_destroy (uint64_t *pt) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
@@ -198,6 +315,9 @@ pml4_destroy (uint64_t *pml4) {
 		return;
 	ASSERT (pml4 != base_pml4);
 
+	/* A new page map may be allocated at the same address. */
+	pcid_forget (pml4);
+
 	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
@@ -206,10 +326,85 @@ pml4_destroy (uint64_t *pml4) {
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  With PCIDs, entries cached for PD since it was last
+ * loaded are kept, if it still has its PCID. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	enum intr_level old_level;
+	int cpu;
+	unsigned pcid;
+
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+	if (!pcid_enabled) {
+		lcr3 (vtop (pml4));
+		return;
+	}
+	if (pml4 == base_pml4) {
+		lcr3 (vtop (pml4) | CR3_NOFLUSH);
+		return;
+	}
+
+	old_level = spin_lock_irqsave (&pcid_lock);
+	cpu = this_cpu ()->id;
+	for (pcid = 1; pcid < PCID_CNT; pcid++)
+		if (pcid_owner[cpu][pcid] == pml4)
+			break;
+	if (pcid < PCID_CNT)
+		lcr3 (vtop (pml4) | pcid | CR3_NOFLUSH);
+	else {
+		pcid = pcid_next[cpu] != 0 ? pcid_next[cpu] : 1;
+		pcid_next[cpu] = pcid + 1 < PCID_CNT ? pcid + 1 : 1;
+		pcid_owner[cpu][pcid] = pml4;
+		lcr3 (vtop (pml4) | pcid);
+	}
+	spin_unlock_irqrestore (&pcid_lock, old_level);
+}
+
+/* Turns on PCIDs if the CPU has them (CPUID.01H:ECX[17]).  Must
+ * be called with base_pml4 loaded, since setting CR4.PCIDE
+ * requires the current PCID to be 0. */
+void
+pcid_init (void) {
+	uint32_t regs[4];
+
+	ASSERT (PTE_ADDR (rcr3 ()) == vtop (base_pml4));
+
+	cpuid (1, regs);
+	if (regs[2] & (1 << 17)) {
+		spin_lock_init (&pcid_lock);
+		lcr4 (rcr4 () | CR4_PCIDE);
+		pcid_enabled = true;
+	}
+}
+
+/* Takes away every PCID that PML4 has. */
+static void
+pcid_forget (uint64_t *pml4) {
+	enum intr_level old_level;
+	int cpu;
+	unsigned pcid;
+
+	if (!pcid_enabled)
+		return;
+
+	old_level = spin_lock_irqsave (&pcid_lock);
+	for (cpu = 0; cpu < cpu_cnt; cpu++)
+		for (pcid = 1; pcid < PCID_CNT; pcid++)
+			if (pcid_owner[cpu][pcid] == pml4)
+				pcid_owner[cpu][pcid] = NULL;
+	spin_unlock_irqrestore (&pcid_lock, old_level);
+}
+
+/* Drops any TLB entry for VA in PML4 after its page table entry
+ * has changed: with invlpg if PML4 is loaded, otherwise by taking
+ * away its PCIDs. */
+static void
+tlb_invalidate (uint64_t *pml4, const void *va) {
+	if (PTE_ADDR (rcr3 ()) == vtop (pml4))
+		invlpg ((uint64_t) va);
+	else
+		pcid_forget (pml4);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -277,8 +472,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_invalidate (pml4, upage);
 	}
 }
 
@@ -303,8 +497,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -329,7 +522,6 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
@@ -2,12 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -36,12 +39,110 @@
 기본적으로 시스템 RAM의 절반은 커널 풀에 주어지고, 나머지 절반은 사용자 풀에 주어집니다.
 이것은 커널 풀에 대해 엄청난 과잉 할당이지만, 이는 디모입니다. */
 
+/* Each pool is managed as a binary buddy system.  A free block of
+   order K is 2**K pages whose first page's index within the pool
+   is a multiple of 2**K.  Free blocks of each order are kept on
+   a list, linked through their first page.  Allocating a block
+   splits the smallest large enough free block in halves until it
+   has the right order; freeing a block merges it with its buddy,
+   the other half of the block of the next order, for as long as
+   the buddy is free too.
+
+   Requests that are not a power of two take the next larger
+   block and give the excess pages at its end back right away, so
+   that, e.g., a 3-page request costs 3 pages and not 4.  For the
+   same reason, any run of pages may be freed, not only what was
+   allocated as a block: it is freed as the largest aligned blocks
+   that make it up.
+
+   used_map still records each page as in use or free, which the
+   buddy lists do not tell, and catches double frees.
+
+   Single pages, by far the most common request, do not reach the
+   buddy system most of the time.  In front of each pool, every
+   processor has two "magazines", stacks of up to MAG_ROUNDS free
+   pages, that it allocates from and frees to with interrupts off
+   and no lock.  Only when both are empty (on allocation) or full
+   (on free) does it take the pool lock, to exchange a magazine
+   with the pool's depot of full and empty ones or, failing that,
+   to refill or drain half a magazine from or to the buddy system
+   in one batch.  Keeping two magazines means a processor
+   alternating between allocating and freeing around a magazine
+   boundary does not go to the depot every time.  Pages in
+   magazines count as in use in used_map; they are given back to
+   the buddy system if it runs out of pages.
+
+   Each pool also keeps a stack of up to ZERO_CACHE_SIZE pages that
+   the idle thread has filled with zeros, through palloc_prezero(),
+   to serve single-page PAL_ZERO requests without clearing a page
+   on the spot.  Like pages in magazines, they are in use as far as
+   the buddy system is concerned until it runs out.
+
+   Since cached pages are in use as far as used_map is concerned,
+   debug builds keep a second bitmap, cached_map, of the pages in
+   magazines or among the pre-zeroed ones, so that freeing one of
+   them again is still caught. */
+
+/* Largest block order.  2**PALLOC_MAX_ORDER pages is 1 GB. */
+#define PALLOC_MAX_ORDER 18
+
+/* In `orders', marks a page that does not start a free block. */
+#define NOT_FREE 0xff
+
+/* Pages per magazine. */
+#define MAG_ROUNDS 16
+
+/* Full and empty magazines each pool's depot can hold. */
+#define DEPOT_SIZE 8
+
+/* Pre-zeroed pages kept per pool. */
+#define ZERO_CACHE_SIZE 32
+
+/* A stack of free pages. */
+struct magazine
+{
+	size_t cnt;				   /* Number of pages. */
+	void *pages[MAG_ROUNDS];   /* Pages, top at pages[cnt - 1]. */
+};
+
+/* A processor's magazines for a pool. */
+struct mag_cache
+{
+	struct magazine *loaded;   /* Used first. */
+	struct magazine *previous; /* Used when `loaded' runs out. */
+};
+
 /* A memory pool. */
 struct pool
 {
-	struct lock lock;		 /* Mutual exclusion. */
+	struct spinlock lock;	 /* Mutual exclusion. */
 	struct bitmap *used_map; /* Bitmap of free pages. */
 	uint8_t *base;			 /* Base of pool. */
+	size_t page_cnt;		 /* Number of pages in pool. */
+	uint8_t *orders;		 /* For each page, order of the free block
+								it starts, or NOT_FREE. */
+	struct list free_lists[PALLOC_MAX_ORDER + 1]; /* Free blocks by order. */
+
+	struct mag_cache caches[CPU_MAX];   /* Per-processor magazines. */
+	struct magazine *full[DEPOT_SIZE];  /* Depot of full magazines... */
+	size_t full_cnt;
+	struct magazine *empty[DEPOT_SIZE]; /* ...and of empty ones. */
+	size_t empty_cnt;
+	struct magazine mags[CPU_MAX * 2 + DEPOT_SIZE]; /* All of them. */
+
+	void *zeroed[ZERO_CACHE_SIZE]; /* Pre-zeroed pages. */
+	size_t zeroed_cnt;
+
+#ifndef NDEBUG
+	struct bitmap *cached_map; /* Pages in magazines or pre-zeroed. */
+#endif
+
+	/* Statistics. */
+	long long hits;        /* Pages moved through a processor's magazines. */
+	long long refills;     /* Magazines refilled from the buddy system. */
+	long long drains;      /* Magazines drained to the buddy system. */
+	long long zero_hits;   /* PAL_ZERO pages served pre-zeroed. */
+	long long zero_misses; /* PAL_ZERO pages zeroed on the spot. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -53,6 +154,23 @@ static void
 init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool(const struct pool *, void *page);
+static void free_block(struct pool *, size_t page_idx, int order);
+static void free_range(struct pool *, size_t page_idx, size_t page_cnt);
+static size_t alloc_pages(struct pool *, size_t page_cnt);
+static void *get_pages(enum palloc_flags, size_t page_cnt, bool *cached);
+static void *mag_alloc(struct pool *, bool *cached);
+static void mag_free(struct pool *, void *page);
+static void *zeroed_alloc(struct pool *);
+static bool zeroed_refill(struct pool *);
+static void pool_reclaim(struct pool *);
+
+#ifndef NDEBUG
+static void set_cached(struct pool *, void *page, bool cached);
+static void poison(void *pages, size_t page_cnt);
+#else
+#define set_cached(POOL, PAGE, CACHED) ((void)0)
+#define poison(PAGES, PAGE_CNT) ((void)0)
+#endif
 
 /* multiboot info */
 struct multiboot_info
@@ -256,19 +374,19 @@ populate_pools(struct area *base_mem, struct area *ext_mem)
 			else
 				NOT_REACHED();
 
-			pool_end = pool->base + bitmap_size(pool->used_map) * PGSIZE;
+			pool_end = pool->base + pool->page_cnt * PGSIZE;
 			page_idx = pg_no(start) - pg_no(pool->base);
 			if ((uint64_t)pool_end < end)
 			{
 				page_cnt = ((uint64_t)pool_end - start) / PGSIZE;
-				bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+				free_range(pool, page_idx, page_cnt);
 				start = (uint64_t)pool_end;
 				goto split;
 			}
 			else
 			{
 				page_cnt = ((uint64_t)end - start) / PGSIZE;
-				bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+				free_range(pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -294,6 +412,40 @@ palloc_init(void)
 	return ext_mem.end;
 }
 
+/* Returns true if the memory map describes all of the SIZE bytes
+   of physical memory starting at START as RAM, that is, as the
+   usable or ACPI reclaimable memory that palloc_init() manages,
+   and false if any of it is a hole or is reserved. */
+bool
+palloc_is_ram(uint64_t start, uint64_t size)
+{
+	struct multiboot_info *mb_info = ptov(MULTIBOOT_INFO);
+	struct e820_entry *entries = ptov(mb_info->mmap_base);
+	uint64_t end = start + size;
+	uint32_t i;
+
+	/* Entries may come in any order and may abut, so advance START
+	   through whichever entry contains it until it reaches END. */
+	while (start < end)
+	{
+		for (i = 0; i < mb_info->mmap_len / sizeof(struct e820_entry); i++)
+		{
+			struct e820_entry *entry = &entries[i];
+			uint64_t entry_start = APPEND_HILO(entry->mem_hi, entry->mem_lo);
+			uint64_t entry_end = entry_start + APPEND_HILO(entry->len_hi, entry->len_lo);
+
+			if ((entry->type == ACPI_RECLAIMABLE || entry->type == USABLE)
+				&& entry_start <= start && start < entry_end)
+				break;
+		}
+		if (i == mb_info->mmap_len / sizeof(struct e820_entry))
+			return false;
+		start = APPEND_HILO(entries[i].mem_hi, entries[i].mem_lo)
+				+ APPEND_HILO(entries[i].len_hi, entries[i].len_lo);
+	}
+	return true;
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -303,31 +455,7 @@ palloc_init(void)
 void *
 palloc_get_multiple(enum palloc_flags flags, size_t page_cnt)
 {
-	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire(&pool->lock);
-
-	size_t page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
-	lock_release(&pool->lock);
-	void *pages;
-
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
-
-	if (pages)
-	{
-		if (flags & PAL_ZERO)
-			memset(pages, 0, PGSIZE * page_cnt);
-	}
-	else
-	{
-		if (flags & PAL_ASSERT)
-			PANIC("palloc_get: out of pages");
-	}
-
-	return pages;
+	return get_pages(flags, page_cnt, NULL);
 }
 
 /* Obtains a single free page and returns its kernel virtual
@@ -346,13 +474,87 @@ PAL_ASSERT가 FLAGS에 설정되어 있지 않은 한 널 포인터를 반환하
 void *
 palloc_get_page(enum palloc_flags flags)
 {
-	return palloc_get_multiple(flags, 1);
+	return get_pages(flags, 1, NULL);
+}
+
+/* Like palloc_get_page(), but also stores in *CACHED whether the
+   page was taken from a processor's magazines or pre-zeroed
+   pages, as opposed to the buddy system. */
+void *
+palloc_get_page_cached(enum palloc_flags flags, bool *cached)
+{
+	ASSERT(cached != NULL);
+
+	*cached = false;
+	return get_pages(flags, 1, cached);
+}
+
+/* Obtains PAGE_CNT pages as described for palloc_get_multiple().
+   If CACHED is nonnull, PAGE_CNT must be 1 and *CACHED is set to
+   true if the page comes from in front of the buddy system. */
+static void *
+get_pages(enum palloc_flags flags, size_t page_cnt, bool *cached)
+{
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level;
+	size_t page_idx;
+	void *pages;
+
+	if (page_cnt == 0)
+		return NULL;
+
+	if (page_cnt == 1 && (flags & PAL_ZERO)
+		&& (pages = zeroed_alloc(pool)) != NULL)
+	{
+		if (cached != NULL)
+			*cached = true;
+		return pages;
+	}
+	if (page_cnt == 1)
+		pages = mag_alloc(pool, cached);
+	else
+	{
+		old_level = spin_lock_irqsave(&pool->lock);
+		page_idx = alloc_pages(pool, page_cnt);
+		if (page_idx == BITMAP_ERROR)
+		{
+			/* Pages cached in front of the buddy system might make
+			   up a block. */
+			pool_reclaim(pool);
+			page_idx = alloc_pages(pool, page_cnt);
+		}
+		spin_unlock_irqrestore(&pool->lock, old_level);
+
+		if (page_idx != BITMAP_ERROR)
+			pages = pool->base + PGSIZE * page_idx;
+		else
+			pages = NULL;
+	}
+
+	if (pages)
+	{
+		if (flags & PAL_ZERO)
+		{
+			if (page_cnt == 1)
+				pool->zero_misses++;
+			memset(pages, 0, PGSIZE * page_cnt);
+		}
+	}
+	else
+	{
+		if (flags & PAL_ASSERT)
+			PANIC("palloc_get: out of pages");
+	}
+
+	return pages;
 }
 
-/* Frees the PAGE_CNT pages starting at PAGES. */
+/* Frees the PAGE_CNT pages starting at PAGES.  May be called with
+   interrupts off, though not from an interrupt handler. */
 void palloc_free_multiple(void *pages, size_t page_cnt)
 {
 	struct pool *pool;
+	enum intr_level old_level;
 	size_t page_idx;
 
 	ASSERT(pg_ofs(pages) == 0);
@@ -368,11 +570,22 @@ void palloc_free_multiple(void *pages, size_t page_cnt)
 
 	page_idx = pg_no(pages) - pg_no(pool->base);
 
-#ifndef NDEBUG
-	memset(pages, 0xcc, PGSIZE * page_cnt);
-#endif
+	/* A single page goes to this processor's magazines as it is,
+	   so that freeing it stays cheap; it is poisoned if it is
+	   drained from there to the buddy system. */
+	if (page_cnt == 1)
+	{
+		ASSERT(bitmap_test(pool->used_map, page_idx));
+		mag_free(pool, pages);
+		return;
+	}
+
+	poison(pages, page_cnt);
+	old_level = spin_lock_irqsave(&pool->lock);
 	ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+	ASSERT(bitmap_none(pool->cached_map, page_idx, page_cnt));
+	free_range(pool, page_idx, page_cnt);
+	spin_unlock_irqrestore(&pool->lock, old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -381,26 +594,398 @@ void palloc_free_page(void *page)
 	palloc_free_multiple(page, 1);
 }
 
+/* Zeroes a free page ahead of time for a later PAL_ZERO request.
+   Returns false if there was nothing to do, because every pool
+   already has enough zeroed pages or is out of free ones.  Called
+   by the idle thread with interrupts on. */
+bool palloc_prezero(void)
+{
+	return zeroed_refill(&kernel_pool) || zeroed_refill(&user_pool);
+}
+
+/* Prints page allocator statistics. */
+void palloc_print_stats(void)
+{
+	printf("Pages: kernel %lld cache hits, %lld refills, %lld drains; "
+		   "user %lld cache hits, %lld refills, %lld drains\n",
+		   kernel_pool.hits, kernel_pool.refills, kernel_pool.drains,
+		   user_pool.hits, user_pool.refills, user_pool.drains);
+	printf("Zeroed pages: kernel %lld ready, %lld on demand; "
+		   "user %lld ready, %lld on demand\n",
+		   kernel_pool.zero_hits, kernel_pool.zero_misses,
+		   user_pool.zero_hits, user_pool.zero_misses);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool(struct pool *p, void **bm_base, uint64_t start, uint64_t end)
 {
-	/* We'll put the pool's used_map at its base.
-	   Calculate the space needed for the bitmap
+	/* We'll put the pool's used_map and block orders at its base.
+	   Calculate the space needed for them
 	   and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(pgcnt), PGSIZE) * PGSIZE;
+	size_t bm_size = ROUND_UP(bitmap_buf_size(pgcnt), sizeof(long));
+	size_t maps_size = bm_size;
+	size_t bm_pages;
+	struct magazine *mag = p->mags;
+	int order;
+	int i;
 
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf(pgcnt, *bm_base, bm_pages);
+#ifndef NDEBUG
+	maps_size += bm_size;
+#endif
+	bm_pages = DIV_ROUND_UP(maps_size + pgcnt, PGSIZE) * PGSIZE;
+
+	spin_lock_init(&p->lock);
+	p->used_map = bitmap_create_in_buf(pgcnt, *bm_base, bm_size);
+#ifndef NDEBUG
+	p->cached_map = bitmap_create_in_buf(pgcnt, (uint8_t *)*bm_base + bm_size, bm_size);
+#endif
 	p->base = (void *)start;
+	p->page_cnt = pgcnt;
+	p->orders = (uint8_t *)*bm_base + maps_size;
+	for (order = 0; order <= PALLOC_MAX_ORDER; order++)
+		list_init(&p->free_lists[order]);
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	memset(p->orders, NOT_FREE, pgcnt);
+
+	for (i = 0; i < CPU_MAX; i++)
+	{
+		p->caches[i].loaded = mag++;
+		p->caches[i].previous = mag++;
+	}
+	for (p->empty_cnt = 0; p->empty_cnt < DEPOT_SIZE; p->empty_cnt++)
+		p->empty[p->empty_cnt] = mag++;
 
 	*bm_base += bm_pages;
 }
 
+/* Returns the kernel virtual address of page PAGE_IDX in POOL. */
+static inline struct list_elem *
+page_elem(const struct pool *pool, size_t page_idx)
+{
+	return (struct list_elem *)(pool->base + page_idx * PGSIZE);
+}
+
+/* Returns the index in POOL of the page whose first bytes are
+   free list element E. */
+static inline size_t
+elem_page(const struct pool *pool, const struct list_elem *e)
+{
+	return ((const uint8_t *)e - pool->base) / PGSIZE;
+}
+
+/* Puts the block of 2**ORDER pages at PAGE_IDX in POOL, which are
+   marked in use, back on the free lists, merging it with its
+   buddies as far as possible. */
+static void
+free_block(struct pool *pool, size_t page_idx, int order)
+{
+	ASSERT(page_idx % ((size_t)1 << order) == 0);
+
+	bitmap_set_multiple(pool->used_map, page_idx, (size_t)1 << order, false);
+	while (order < PALLOC_MAX_ORDER)
+	{
+		size_t buddy = page_idx ^ ((size_t)1 << order);
+
+		if (buddy >= pool->page_cnt || pool->orders[buddy] != order)
+			break;
+		list_remove(page_elem(pool, buddy));
+		pool->orders[buddy] = NOT_FREE;
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	pool->orders[page_idx] = order;
+	list_push_front(&pool->free_lists[order], page_elem(pool, page_idx));
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, all in use, as
+   the largest aligned blocks that make them up. */
+static void
+free_range(struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+	while (page_cnt > 0)
+	{
+		int order = 0;
+
+		while (order < PALLOC_MAX_ORDER
+			   && page_idx % ((size_t)2 << order) == 0
+			   && ((size_t)2 << order) <= page_cnt)
+			order++;
+		free_block(pool, page_idx, order);
+		page_idx += (size_t)1 << order;
+		page_cnt -= (size_t)1 << order;
+	}
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if there is no free block
+   large enough. */
+static size_t
+alloc_pages(struct pool *pool, size_t page_cnt)
+{
+	int want = 0, order;
+	size_t page_idx;
+
+	while (((size_t)1 << want) < page_cnt)
+		if (++want > PALLOC_MAX_ORDER)
+			return BITMAP_ERROR;
+
+	/* Smallest free block that is large enough. */
+	for (order = want; order <= PALLOC_MAX_ORDER; order++)
+		if (!list_empty(&pool->free_lists[order]))
+			break;
+	if (order > PALLOC_MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = elem_page(pool, list_pop_front(&pool->free_lists[order]));
+	pool->orders[page_idx] = NOT_FREE;
+
+	/* Split it, freeing the upper halves. */
+	while (order > want)
+	{
+		size_t half;
+
+		order--;
+		half = page_idx + ((size_t)1 << order);
+		pool->orders[half] = order;
+		list_push_front(&pool->free_lists[order], page_elem(pool, half));
+	}
+
+	ASSERT(!bitmap_any(pool->used_map, page_idx, (size_t)1 << want));
+	bitmap_set_multiple(pool->used_map, page_idx, (size_t)1 << want, true);
+
+	/* Give back the pages past PAGE_CNT. */
+	free_range(pool, page_idx + page_cnt, ((size_t)1 << want) - page_cnt);
+	return page_idx;
+}
+
+/* Allocates a page from this processor's magazines for POOL, or
+   a null pointer if the pool is out of pages.  If CACHED is
+   nonnull, sets *CACHED to true if the page was already in one of
+   the magazines, without refilling them. */
+static void *
+mag_alloc(struct pool *pool, bool *cached)
+{
+	enum intr_level old_level = intr_disable();
+	struct mag_cache *mc = &pool->caches[this_cpu()->id];
+	size_t page_idx;
+	void *page = NULL;
+
+	if (mc->loaded->cnt == 0 && mc->previous->cnt > 0)
+	{
+		struct magazine *tmp = mc->loaded;
+		mc->loaded = mc->previous;
+		mc->previous = tmp;
+	}
+	if (mc->loaded->cnt > 0 && cached != NULL)
+		*cached = true;
+	if (mc->loaded->cnt == 0)
+	{
+		/* Interrupts are already off. */
+		spin_lock_irqsave(&pool->lock);
+		if (pool->full_cnt > 0)
+		{
+			/* Trade the empty magazine for a full one. */
+			pool->empty[pool->empty_cnt++] = mc->loaded;
+			mc->loaded = pool->full[--pool->full_cnt];
+		}
+		else
+		{
+			/* Refill half a magazine, leaving room for frees. */
+			pool->refills++;
+			while (mc->loaded->cnt < MAG_ROUNDS / 2
+				   && (page_idx = alloc_pages(pool, 1)) != BITMAP_ERROR)
+			{
+				void *p = pool->base + PGSIZE * page_idx;
+				set_cached(pool, p, true);
+				mc->loaded->pages[mc->loaded->cnt++] = p;
+			}
+		}
+		spin_unlock_irqrestore(&pool->lock, INTR_OFF);
+	}
+	if (mc->loaded->cnt > 0)
+	{
+		page = mc->loaded->pages[--mc->loaded->cnt];
+		set_cached(pool, page, false);
+		pool->hits++;
+	}
+	intr_set_level(old_level);
+
+	/* The buddy system is empty, but other magazines may not be. */
+	if (page == NULL)
+	{
+		old_level = spin_lock_irqsave(&pool->lock);
+		pool_reclaim(pool);
+		page_idx = alloc_pages(pool, 1);
+		spin_unlock_irqrestore(&pool->lock, old_level);
+		if (page_idx != BITMAP_ERROR)
+			page = pool->base + PGSIZE * page_idx;
+	}
+	return page;
+}
+
+/* Frees PAGE, which belongs to POOL, to this processor's
+   magazines for POOL. */
+static void
+mag_free(struct pool *pool, void *page)
+{
+	enum intr_level old_level = intr_disable();
+	struct mag_cache *mc = &pool->caches[this_cpu()->id];
+
+	if (mc->loaded->cnt == MAG_ROUNDS && mc->previous->cnt < MAG_ROUNDS)
+	{
+		struct magazine *tmp = mc->loaded;
+		mc->loaded = mc->previous;
+		mc->previous = tmp;
+	}
+	if (mc->loaded->cnt == MAG_ROUNDS)
+	{
+		/* Interrupts are already off. */
+		spin_lock_irqsave(&pool->lock);
+		if (pool->empty_cnt > 0 && pool->full_cnt < DEPOT_SIZE)
+		{
+			/* Trade the full magazine for an empty one. */
+			pool->full[pool->full_cnt++] = mc->loaded;
+			mc->loaded = pool->empty[--pool->empty_cnt];
+		}
+		else
+		{
+			/* Drain half a magazine, leaving pages for allocations. */
+			pool->drains++;
+			while (mc->loaded->cnt > MAG_ROUNDS / 2)
+			{
+				void *p = mc->loaded->pages[--mc->loaded->cnt];
+				set_cached(pool, p, false);
+				poison(p, 1);
+				free_range(pool, pg_no(p) - pg_no(pool->base), 1);
+			}
+		}
+		spin_unlock_irqrestore(&pool->lock, INTR_OFF);
+	}
+	set_cached(pool, page, true);
+	mc->loaded->pages[mc->loaded->cnt++] = page;
+	pool->hits++;
+	intr_set_level(old_level);
+}
+
+/* Takes a pre-zeroed page from POOL, or returns a null pointer if
+   there is none. */
+static void *
+zeroed_alloc(struct pool *pool)
+{
+	enum intr_level old_level = spin_lock_irqsave(&pool->lock);
+	void *page = NULL;
+
+	if (pool->zeroed_cnt > 0)
+	{
+		page = pool->zeroed[--pool->zeroed_cnt];
+		set_cached(pool, page, false);
+		pool->zero_hits++;
+	}
+	spin_unlock_irqrestore(&pool->lock, old_level);
+	return page;
+}
+
+/* Zeroes one free page of POOL and adds it to POOL's pre-zeroed
+   pages.  Returns false if POOL already has enough of them or has
+   no free page.  The zeroing itself is done with interrupts on,
+   since it is the slow part. */
+static bool
+zeroed_refill(struct pool *pool)
+{
+	enum intr_level old_level;
+	size_t page_idx = BITMAP_ERROR;
+	void *page;
+
+	ASSERT(intr_get_level() == INTR_ON);
+
+	old_level = spin_lock_irqsave(&pool->lock);
+	if (pool->zeroed_cnt < ZERO_CACHE_SIZE)
+		page_idx = alloc_pages(pool, 1);
+	spin_unlock_irqrestore(&pool->lock, old_level);
+	if (page_idx == BITMAP_ERROR)
+		return false;
+
+	page = pool->base + PGSIZE * page_idx;
+	memset(page, 0, PGSIZE);
+
+	old_level = spin_lock_irqsave(&pool->lock);
+	if (pool->zeroed_cnt < ZERO_CACHE_SIZE)
+	{
+		set_cached(pool, page, true);
+		pool->zeroed[pool->zeroed_cnt++] = page;
+	}
+	else
+		free_range(pool, page_idx, 1);
+	spin_unlock_irqrestore(&pool->lock, old_level);
+	return true;
+}
+
+/* Gives the pages in the depot's full magazines, in this
+   processor's magazines for POOL, and in POOL's pre-zeroed pages
+   back to the buddy system.  The pool lock must be held. */
+static void
+pool_reclaim(struct pool *pool)
+{
+	struct mag_cache *mc = &pool->caches[this_cpu()->id];
+	struct magazine *mags[DEPOT_SIZE + 2];
+	size_t cnt = 0;
+	size_t i;
+
+	ASSERT(spin_lock_held(&pool->lock));
+
+	mags[cnt++] = mc->loaded;
+	mags[cnt++] = mc->previous;
+	while (pool->full_cnt > 0)
+	{
+		mags[cnt] = pool->full[--pool->full_cnt];
+		pool->empty[pool->empty_cnt++] = mags[cnt++];
+	}
+	for (i = 0; i < cnt; i++)
+		while (mags[i]->cnt > 0)
+		{
+			void *p = mags[i]->pages[--mags[i]->cnt];
+			set_cached(pool, p, false);
+			poison(p, 1);
+			free_range(pool, pg_no(p) - pg_no(pool->base), 1);
+		}
+	while (pool->zeroed_cnt > 0)
+	{
+		void *p = pool->zeroed[--pool->zeroed_cnt];
+		set_cached(pool, p, false);
+		free_range(pool, pg_no(p) - pg_no(pool->base), 1);
+	}
+}
+
+#ifndef NDEBUG
+/* Records in POOL's cached_map that PAGE has entered (if CACHED is
+   true) or left a magazine or the pre-zeroed pages.  A page that
+   enters twice has been freed twice. */
+static void
+set_cached(struct pool *pool, void *page, bool cached)
+{
+	size_t page_idx = pg_no(page) - pg_no(pool->base);
+
+	ASSERT(bitmap_test(pool->cached_map, page_idx) != cached);
+	bitmap_set(pool->cached_map, page_idx, cached);
+}
+
+/* Fills the PAGE_CNT pages at PAGES, which were freed and are
+   going back to the buddy system, with a pattern that makes uses
+   after free easier to spot.  Pages waiting in the magazines are
+   left alone, and pre-zeroed pages were not used since they were
+   zeroed. */
+static void
+poison(void *pages, size_t page_cnt)
+{
+	memset(pages, 0xcc, PGSIZE * page_cnt);
+}
+#endif
+
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
@@ -408,6 +993,6 @@ page_from_pool(const struct pool *pool, void *page)
 {
 	size_t page_no = pg_no(page);
 	size_t start_page = pg_no(pool->base);
-	size_t end_page = start_page + bitmap_size(pool->used_map);
+	size_t end_page = start_page + pool->page_cnt;
 	return page_no >= start_page && page_no < end_page;
 }
@@ -0,0 +1,292 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator, after Bonwick's "The Slab Allocator: An
+   Object-Caching Kernel Memory Allocator" (USENIX 1994).
+
+   Each cache carves pages, called slabs, into objects of one
+   size.  A slab starts with a header that includes a stack of the
+   indexes of its free objects, followed by the objects themselves.
+   The free stack is kept outside the objects so that freeing an
+   object does not overwrite it, which is what lets constructed
+   state survive from one use of an object to the next.
+
+   A cache keeps its slabs on three lists: partial slabs, which
+   allocations come from first, full slabs, and at most
+   KMEM_EMPTY_MAX empty slabs kept around to absorb churn.  Further
+   empty slabs go back to the page allocator.
+
+   The bytes a slab has left over after its objects are used for
+   "coloring": each new slab of a cache starts its objects one
+   cache line further in than the last, wrapping around, so that
+   the first objects of different slabs do not all compete for the
+   same cache sets. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Maximum number of caches. */
+#define KMEM_CACHE_MAX 32
+
+/* Empty slabs a cache keeps. */
+#define KMEM_EMPTY_MAX 1
+
+/* Coloring step, at least a cache line. */
+#define KMEM_COLOR_STEP 64
+
+/* A cache of objects of one type. */
+struct kmem_cache {
+	const char *name;           /* Name, for statistics. */
+	size_t size;                /* Object size, a multiple of `align'. */
+	size_t align;               /* Object alignment. */
+	void (*ctor) (void *);      /* Constructor, or null. */
+	size_t objs_per_slab;       /* Objects in a slab. */
+	size_t objs_ofs;            /* Offset of first object, before coloring. */
+	size_t color_range;         /* Leftover bytes in a slab. */
+	size_t color_next;          /* Color of the next new slab. */
+
+	struct spinlock lock;       /* Protects the rest. */
+	struct list partial;        /* Slabs with free and used objects. */
+	struct list full;           /* Slabs with no free objects. */
+	struct list empty;          /* Slabs with no used objects. */
+	size_t empty_cnt;           /* Number of slabs on `empty'. */
+
+	/* Statistics. */
+	size_t slab_cnt;            /* Slabs owned. */
+	size_t inuse;               /* Objects allocated. */
+	long long allocs;           /* kmem_cache_alloc() calls that succeeded. */
+	long long frees;            /* kmem_cache_free() calls. */
+	long long grows;            /* Slabs obtained from palloc. */
+	long long reaps;            /* Slabs given back to palloc. */
+};
+
+/* Slab header, at the start of each slab's page. */
+struct slab {
+	unsigned magic;             /* Always SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* In one of the cache's lists. */
+	uint8_t *objs;              /* First object. */
+	size_t inuse;               /* Number of allocated objects. */
+	size_t free_cnt;            /* Number of entries in `free_idx'. */
+	uint16_t free_idx[];        /* Indexes of free objects. */
+};
+
+static struct kmem_cache caches[KMEM_CACHE_MAX];
+static size_t cache_cnt;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Creates a cache of objects SIZE bytes long, aligned on ALIGN
+   bytes, a power of 2, or on the size of a pointer if ALIGN is 0.
+   If CTOR is nonnull, it is called on each object when its slab
+   is created.  NAME is used in statistics and must remain valid.
+   Panics if too many caches are created or if SIZE is too big for
+   several objects to fit in a page, which is what caches are
+   for. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, size_t align,
+		void (*ctor) (void *)) {
+	struct kmem_cache *c;
+	size_t n;
+
+	ASSERT (name != NULL);
+	ASSERT (size > 0);
+	ASSERT ((align & (align - 1)) == 0);
+
+	if (cache_cnt >= KMEM_CACHE_MAX)
+		PANIC ("kmem_cache_create: too many caches creating \"%s\"", name);
+	c = &caches[cache_cnt++];
+
+	if (align < sizeof (void *))
+		align = sizeof (void *);
+	size = ROUND_UP (size, align);
+
+	/* Fit as many objects as possible after the header. */
+	for (n = (PGSIZE - sizeof (struct slab)) / (size + sizeof (uint16_t));
+			n > 0; n--)
+		if (ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t), align)
+				+ n * size <= PGSIZE)
+			break;
+	if (n < 4)
+		PANIC ("kmem_cache_create: objects in \"%s\" too big (%zu bytes)",
+				name, size);
+
+	c->name = name;
+	c->size = size;
+	c->align = align;
+	c->ctor = ctor;
+	c->objs_per_slab = n;
+	c->objs_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+			align);
+	c->color_range = PGSIZE - c->objs_ofs - n * size;
+	c->color_next = 0;
+	spin_lock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->empty_cnt = 0;
+	return c;
+}
+
+/* Allocates an object from cache C and returns it, or a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	enum intr_level old_level;
+	struct slab *s;
+	void *obj;
+
+	ASSERT (c != NULL);
+
+	old_level = spin_lock_irqsave (&c->lock);
+	if (list_empty (&c->partial)) {
+		if (!list_empty (&c->empty)) {
+			list_push_front (&c->partial, list_pop_front (&c->empty));
+			c->empty_cnt--;
+		} else {
+			/* Grow the cache.  Constructing a slab's objects may take
+			   a while, so do it without the lock. */
+			spin_unlock_irqrestore (&c->lock, old_level);
+			s = slab_create (c);
+			if (s == NULL)
+				return NULL;
+			old_level = spin_lock_irqsave (&c->lock);
+			list_push_front (&c->partial, &s->elem);
+			c->slab_cnt++;
+			c->grows++;
+		}
+	}
+
+	s = list_entry (list_front (&c->partial), struct slab, elem);
+	ASSERT (s->free_cnt > 0);
+	obj = s->objs + s->free_idx[--s->free_cnt] * c->size;
+	if (++s->inuse == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	c->inuse++;
+	c->allocs++;
+	spin_unlock_irqrestore (&c->lock, old_level);
+	return obj;
+}
+
+/* Frees OBJ, which must have been allocated from cache C.  A null
+   OBJ is ignored. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	enum intr_level old_level;
+	struct slab *s;
+	struct slab *reap = NULL;
+
+	if (obj == NULL)
+		return;
+	s = obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   its constructed state has to be preserved. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->size);
+#endif
+
+	old_level = spin_lock_irqsave (&c->lock);
+	ASSERT (s->free_cnt < c->objs_per_slab);
+	s->free_idx[s->free_cnt++] = ((uint8_t *) obj - s->objs) / c->size;
+	if (s->inuse-- == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	if (s->inuse == 0) {
+		list_remove (&s->elem);
+		if (c->empty_cnt < KMEM_EMPTY_MAX) {
+			list_push_front (&c->empty, &s->elem);
+			c->empty_cnt++;
+		} else {
+			reap = s;
+			c->slab_cnt--;
+			c->reaps++;
+		}
+	}
+	c->inuse--;
+	c->frees++;
+	spin_unlock_irqrestore (&c->lock, old_level);
+
+	if (reap != NULL) {
+		reap->magic = 0;
+		palloc_free_page (reap);
+	}
+}
+
+/* Prints statistics for each cache. */
+void
+kmem_print_stats (void) {
+	size_t i;
+
+	for (i = 0; i < cache_cnt; i++) {
+		struct kmem_cache *c = &caches[i];
+
+		printf ("Slab %s: %zu-byte objects, %zu in use in %zu slabs, "
+				"%lld allocs, %lld frees, %lld grows, %lld reaps\n",
+				c->name, c->size, c->inuse, c->slab_cnt,
+				c->allocs, c->frees, c->grows, c->reaps);
+	}
+}
+
+/* Obtains a page for a new slab of cache C and initializes it,
+   running C's constructor on each object.  Returns the new slab,
+   or a null pointer if memory is not available. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s = palloc_get_page (0);
+	enum intr_level old_level;
+	size_t color;
+	size_t i;
+
+	if (s == NULL)
+		return NULL;
+
+	old_level = spin_lock_irqsave (&c->lock);
+	color = c->color_next;
+	c->color_next += c->align > KMEM_COLOR_STEP ? c->align : KMEM_COLOR_STEP;
+	if (c->color_next > c->color_range)
+		c->color_next = 0;
+	spin_unlock_irqrestore (&c->lock, old_level);
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->objs = (uint8_t *) s + c->objs_ofs + color;
+	s->inuse = 0;
+	s->free_cnt = c->objs_per_slab;
+
+	/* Hand out objects from the front of the slab first. */
+	for (i = 0; i < c->objs_per_slab; i++) {
+		s->free_idx[i] = c->objs_per_slab - 1 - i;
+		if (c->ctor != NULL)
+			c->ctor (s->objs + i * c->size);
+	}
+	return s;
+}
+
+/* Returns the slab that OBJ, an object of cache C, is in. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	ASSERT (c != NULL);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT ((uint8_t *) obj >= s->objs);
+	ASSERT (((uint8_t *) obj - s->objs) % c->size == 0);
+	ASSERT ((size_t) ((uint8_t *) obj - s->objs) / c->size < c->objs_per_slab);
+
+	return s;
+}
@@ -31,6 +31,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "devices/timer.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
@@ -48,7 +50,7 @@ void sema_init(struct semaphore *sema, unsigned value)
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    pq_init(&sema->waiters);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -69,8 +71,10 @@ void sema_down(struct semaphore *sema)
     old_level = intr_disable();
     while (sema->value == 0)
     { // 0이면은 락이없으니까 세마 리스트 들어간다. + 블락
-        // list_push_back(&sema->waiters, &thread_current()->elem);
-        list_insert_ordered(&sema->waiters, &thread_current()->elem, decrease_func, NULL);
+        struct thread *curr = thread_current();
+
+        pq_push(&sema->waiters, &curr->wait_elem, curr->priority);
+        curr->wait_queue = &sema->waiters;
         thread_block();
     }
     sema->value--;
@@ -102,6 +106,25 @@ bool sema_try_down(struct semaphore *sema)
     return success;
 }
 
+/* Increments SEMA's value and unblocks its highest-priority
+   waiter, if any, without preempting the running thread.
+   Interrupts must be off. */
+static void sema_wake(struct semaphore *sema)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!pq_empty(&sema->waiters))
+    {
+        /* Waiters are keyed on their effective priority, which
+           thread_set_effective_priority() keeps current. */
+        struct thread *t = pq_entry(pq_pop(&sema->waiters), struct thread, wait_elem);
+
+        t->wait_queue = NULL;
+        thread_unblock(t);
+    }
+    sema->value++; // 원자성 보장하기 위해
+}
+
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
    and wakes up one thread of those waiting for SEMA, if any.
 
@@ -113,17 +136,8 @@ void sema_up(struct semaphore *sema)
     ASSERT(sema != NULL);
 
     old_level = intr_disable();
-    if (!list_empty(&sema->waiters))
-    {
-        /* donate 상황에서 세마 리스트 뒤에 우선순위가 변경된 경우 정렬이 안되어 있을 수 있으므로 */
-        list_sort(&sema->waiters, decrease_func, NULL);
-
-        thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
-    }
-    sema->value++; // 원자성 보장하기 위해
-    int p = thread_get_priority();
-
-    run_highest_priority_thread(p);
+    sema_wake(sema);
+    run_highest_priority_thread(thread_get_priority());
     intr_set_level(old_level);
 }
 
@@ -162,6 +176,140 @@ static void sema_test_helper(void *sema_)
     }
 }
 
+/* Lock profiling.
+
+   Statistics are kept per lock name rather than per lock, so
+   that locks embedded in objects that come and go, such as
+   inodes, add up to one line and do not leave dangling entries
+   behind.  Names are the string literals made by lock_init(),
+   so most lookups succeed on the pointer comparison. */
+
+/* Whether to profile locks initialized from now on. */
+bool lock_profiling;
+
+/* Contention statistics for all locks with one name. */
+struct lock_stat
+{
+    const char *name;      /* Lock name, null if entry is free. */
+    int64_t acquires;      /* Number of acquisitions. */
+    int64_t contended;     /* Acquisitions that had to wait. */
+    int64_t wait_ns;       /* Total nanoseconds spent waiting. */
+    int64_t max_wait;      /* Longest single wait, in ns. */
+    void *max_wait_site;   /* Caller of lock_acquire() for max_wait. */
+    int64_t max_hold;      /* Longest hold, in ns. */
+};
+
+/* Maximum number of distinct lock names tracked.  Locks named
+   after that are not profiled. */
+#define LOCK_STAT_CNT 64
+
+/* Number of entries printed by lock_print_stats(). */
+#define LOCK_STAT_TOP 10
+
+static struct lock_stat lock_stats[LOCK_STAT_CNT];
+static struct spinlock lock_stats_lock; /* Guards new entries. */
+
+/* Returns the statistics entry for NAME, creating it if needed,
+   or a null pointer if the table is full. */
+static struct lock_stat *lock_stat_lookup(const char *name)
+{
+    struct lock_stat *ls;
+    enum intr_level old_level = spin_lock_irqsave(&lock_stats_lock);
+
+    for (ls = lock_stats; ls < lock_stats + LOCK_STAT_CNT; ls++)
+    {
+        if (ls->name == NULL)
+        {
+            ls->name = name;
+            break;
+        }
+        if (ls->name == name || !strcmp(ls->name, name))
+            break;
+    }
+    spin_unlock_irqrestore(&lock_stats_lock, old_level);
+    return ls < lock_stats + LOCK_STAT_CNT ? ls : NULL;
+}
+
+/* Accounts for an acquisition of LOCK by the current thread,
+   which waited WAIT nanoseconds for it from call site SITE. */
+static void lock_stat_acquired(struct lock *lock, int64_t wait, void *site)
+{
+    struct lock_stat *ls = lock->stat;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    ls->acquires++;
+    if (site != NULL)
+    {
+        ls->contended++;
+        ls->wait_ns += wait;
+        if (ls->max_wait_site == NULL || wait > ls->max_wait)
+        {
+            ls->max_wait = wait;
+            ls->max_wait_site = site;
+        }
+    }
+    lock->acquired = timer_ns();
+}
+
+/* Accounts for the release of LOCK. */
+static void lock_stat_released(struct lock *lock)
+{
+    struct lock_stat *ls = lock->stat;
+    int64_t hold = timer_ns() - lock->acquired;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (hold > ls->max_hold)
+        ls->max_hold = hold;
+}
+
+/* Returns true if A has hurt more than B: more time spent
+   waiting for it, or more contended acquisitions. */
+static bool lock_stat_worse(const struct lock_stat *a, const struct lock_stat *b)
+{
+    if (a->wait_ns != b->wait_ns)
+        return a->wait_ns > b->wait_ns;
+    if (a->contended != b->contended)
+        return a->contended > b->contended;
+    return a->acquires > b->acquires;
+}
+
+/* Prints the most contended locks, if lock profiling is on.  The
+   call site is the caller of lock_acquire() that waited longest;
+   feed it to backtrace to get a source line.  Times are in
+   microseconds. */
+void lock_print_stats(void)
+{
+    struct lock_stat *top[LOCK_STAT_CNT];
+    struct lock_stat *ls;
+    int cnt = 0;
+    int i;
+
+    if (!lock_profiling)
+        return;
+
+    /* Insertion sort, worst first. */
+    for (ls = lock_stats; ls < lock_stats + LOCK_STAT_CNT && ls->name != NULL; ls++)
+    {
+        for (i = cnt++; i > 0 && lock_stat_worse(ls, top[i - 1]); i--)
+            top[i] = top[i - 1];
+        top[i] = ls;
+    }
+
+    printf("Locks: %d names profiled, top %d by wait time:\n",
+           cnt, cnt < LOCK_STAT_TOP ? cnt : LOCK_STAT_TOP);
+    printf("  %-20s %10s %10s %10s %10s %10s  %s\n", "name", "acquires",
+           "contended", "wait", "max wait", "max hold", "site");
+    for (i = 0; i < cnt && i < LOCK_STAT_TOP; i++)
+    {
+        ls = top[i];
+        printf("  %-20s %10lld %10lld %10lld %10lld %10lld  %p\n", ls->name,
+               ls->acquires, ls->contended, ls->wait_ns / 1000,
+               ls->max_wait / 1000, ls->max_hold / 1000, ls->max_wait_site);
+    }
+}
+
 /* Initializes LOCK.  A lock can be held by at most a single
    thread at any given time.  Our locks are not "recursive", that
    is, it is an error for the thread currently holding a lock to
@@ -176,13 +324,55 @@ static void sema_test_helper(void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
-void lock_init(struct lock *lock)
+   instead of a lock.
+
+   NAME identifies LOCK in the lock profile.  The lock_init()
+   macro supplies it. */
+void lock_init_named(struct lock *lock, const char *name)
 {
     ASSERT(lock != NULL);
+    ASSERT(name != NULL);
 
     lock->holder = NULL;
     sema_init(&lock->semaphore, 1);
+    memset(&lock->donation_elem, 0, sizeof lock->donation_elem);
+    lock->stat = lock_profiling ? lock_stat_lookup(name) : NULL;
+    lock->acquired = 0;
+}
+
+/* Priority donation.
+
+   Every thread keeps the locks it holds that have waiters in its
+   `donations' priority queue, each keyed on the highest priority
+   among the threads waiting for that lock.  All donations made
+   through one lock are thus grouped under a single element.  A
+   thread's effective priority is the larger of its own priority
+   and the top of that queue, so it is available in O(1);
+   releasing a lock drops its element in O(log n) amortized time,
+   and raising a lock's key when a new or more urgent waiter
+   arrives is O(1) amortized. */
+
+/* Donates PRIORITY through LOCK to its holder and, if that holder
+   is itself waiting for a lock, on down the chain.  Stops as soon
+   as a lock already carries at least PRIORITY. */
+static void donate_priority(struct lock *lock, int priority)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (lock != NULL && lock->holder != NULL)
+    {
+        struct thread *holder = lock->holder;
+        struct pq_elem *e = &lock->donation_elem;
+
+        if (!pq_contains(&holder->donations, e))
+            pq_push(&holder->donations, e, priority);
+        else if (e->key < priority)
+            pq_update(&holder->donations, e, priority);
+        else
+            break;
+        thread_refresh_priority(holder);
+        lock = holder->wait_on_lock;
+    }
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -193,76 +383,43 @@ void lock_init(struct lock *lock)
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
-
-/* priority donation을 수행 */
-void donate_priority(struct lock *lock)
+void lock_acquire(struct lock *lock)
 {
+    struct thread *curr = thread_current();
     enum intr_level old_level;
-    old_level = intr_disable();
-    if (lock->holder->priority < thread_current()->priority)
-    {
-        list_insert_ordered(&(lock->holder->donation_list), &(thread_current()->donation_elem), decrease_func, NULL);
-        while (true)
-        {
-            lock->holder->priority = thread_current()->priority;
-            if (lock->holder->wait_on_lock == NULL)
-                return;
-            lock = lock->holder->wait_on_lock;
-        }
-    }
-    intr_set_level(old_level);
-}
+    void *site = NULL;
+    int64_t wait_start = 0;
 
-/* 도네이션 리스트를 순회한다 > 해당 스레드 elem 을 entry 로 꺼내서 thread-> wait_on_lock ==  lock >> 얘를 빼준다. */
-void remove_with_lock(struct lock *lock)
-{
-    // enum intr_level old_level;
-    // old_level = intr_disable();
-    struct list_elem *tmp = list_begin(&(lock->holder->donation_list));
-    struct thread *tmp_t;
-    for (tmp; tmp != list_end(&(lock->holder->donation_list)); tmp = list_next(tmp))
-    {
-        tmp_t = list_entry(tmp, struct thread, donation_elem);
-        if (tmp_t->wait_on_lock == lock)
-        {
-            list_remove(tmp);
-        }
-    }
-    // (old_level);
-}
+    ASSERT(lock != NULL);
+    ASSERT(!intr_context());
+    ASSERT(!lock_held_by_current_thread(lock));
 
-void refresh_priority(void)
-{
-    struct thread *curr = thread_current();
-    struct list *donations = &(thread_current()->donation_list);
-    struct thread *donations_root;
+    old_level = intr_disable();
 
-    if (list_empty(donations)) // donors가 없으면 (donor가 하나였던 경우)
+    if (lock->stat != NULL && lock->holder != NULL)
     {
-        curr->priority = curr->prev_priority; // 최초의 priority로 변경
-        return;
+        site = __builtin_return_address(0);
+        wait_start = timer_ns();
     }
 
-    donations_root = list_entry(list_front(donations), struct thread, donation_elem);
-    curr->priority = donations_root->priority;
-}
-
-void lock_acquire(struct lock *lock)
-{
-    ASSERT(lock != NULL);
-    ASSERT(!intr_context());
-    ASSERT(!lock_held_by_current_thread(lock));
-
     /* 만약 락 쥐고있는 애가 있으면 우선순위비교해서 그 녀석에게 도네이션한다.-> 락을 빨리 release하도록 */
-    if (lock->holder != NULL)
+    if (lock->holder != NULL && !thread_mlfqs)
     {
-        thread_current()->wait_on_lock = lock;
-        donate_priority(lock);
+        curr->wait_on_lock = lock;
+        donate_priority(lock, curr->priority);
     }
 
     sema_down(&lock->semaphore);
-    thread_current()->wait_on_lock = NULL;
-    lock->holder = thread_current();
+    curr->wait_on_lock = NULL;
+    lock->holder = curr;
+
+    /* Threads still queued on the lock now donate to us. */
+    if (!thread_mlfqs && !pq_empty(&lock->semaphore.waiters))
+        donate_priority(lock, pq_top(&lock->semaphore.waiters)->key);
+
+    if (lock->stat != NULL)
+        lock_stat_acquired(lock, site != NULL ? timer_ns() - wait_start : 0, site);
+    intr_set_level(old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -280,7 +437,15 @@ bool lock_try_acquire(struct lock *lock)
 
     success = sema_try_down(&lock->semaphore);
     if (success)
+    {
         lock->holder = thread_current();
+        if (lock->stat != NULL)
+        {
+            enum intr_level old_level = intr_disable();
+            lock_stat_acquired(lock, 0, NULL);
+            intr_set_level(old_level);
+        }
+    }
     return success;
 }
 
@@ -292,15 +457,23 @@ bool lock_try_acquire(struct lock *lock)
    handler. */
 void lock_release(struct lock *lock)
 {
+    struct thread *curr = thread_current();
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
-    if (!list_empty(&lock->holder->donation_list))
+
+    old_level = intr_disable();
+    if (pq_contains(&curr->donations, &lock->donation_elem))
     {
-        remove_with_lock(lock);
-        refresh_priority();
+        pq_remove(&curr->donations, &lock->donation_elem);
+        thread_refresh_priority(curr);
     }
+    if (lock->stat != NULL)
+        lock_stat_released(lock);
     lock->holder = NULL;
     sema_up(&lock->semaphore);
+    intr_set_level(old_level);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -316,8 +489,9 @@ bool lock_held_by_current_thread(const struct lock *lock)
 /* One semaphore in a list. */
 struct semaphore_elem
 {
-    struct list_elem elem;      /* List element. */
+    struct pq_elem elem;        /* Priority queue element. */
     struct semaphore semaphore; /* This semaphore. */
+    struct thread *thread;      /* Waiting thread. */
 };
 
 /* Initializes condition variable COND.  A condition variable
@@ -327,7 +501,7 @@ void cond_init(struct condition *cond)
 {
     ASSERT(cond != NULL);
 
-    list_init(&cond->waiters);
+    pq_init(&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -351,20 +525,10 @@ void cond_init(struct condition *cond)
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 
-bool decrease_sema_func(const struct list_elem *a, const struct list_elem *b, void *aux)
-{
-    struct semaphore_elem *sema_elem_a = list_entry(a, struct semaphore_elem, elem);
-    struct semaphore_elem *sema_elem_b = list_entry(b, struct semaphore_elem, elem);
-
-    struct thread *thread_a = list_entry(list_begin(&sema_elem_a->semaphore.waiters), struct thread, elem);
-    struct thread *thread_b = list_entry(list_begin(&sema_elem_b->semaphore.waiters), struct thread, elem);
-
-    return thread_a->priority > thread_b->priority;
-}
-
 void cond_wait(struct condition *cond, struct lock *lock)
 {
     struct semaphore_elem waiter;
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
@@ -372,13 +536,32 @@ void cond_wait(struct condition *cond, struct lock *lock)
     ASSERT(lock_held_by_current_thread(lock));
 
     sema_init(&waiter.semaphore, 0);
-    // list_push_back(&cond->waiters, &waiter.elem);
-    list_insert_ordered(&cond->waiters, &waiter.elem, decrease_sema_func, NULL);
+    waiter.thread = thread_current();
+
+    /* Donations may change our priority while we wait, so the
+       queue is only touched with interrupts off. */
+    old_level = intr_disable();
+    pq_push(&cond->waiters, &waiter.elem, waiter.thread->priority);
+    waiter.thread->cond_elem = &waiter.elem;
+    waiter.thread->cond_queue = &cond->waiters;
+    intr_set_level(old_level);
+
     lock_release(lock);
     sema_down(&waiter.semaphore);
     lock_acquire(lock);
 }
 
+/* Removes and returns COND's highest-priority waiter.  Interrupts
+   must be off. */
+static struct semaphore_elem *cond_pop(struct condition *cond)
+{
+    struct semaphore_elem *waiter = pq_entry(pq_pop(&cond->waiters), struct semaphore_elem, elem);
+
+    waiter->thread->cond_elem = NULL;
+    waiter->thread->cond_queue = NULL;
+    return waiter;
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
    LOCK must be held before calling this function.
@@ -388,15 +571,17 @@ void cond_wait(struct condition *cond, struct lock *lock)
    interrupt handler. */
 void cond_signal(struct condition *cond, struct lock *lock UNUSED)
 {
+    enum intr_level old_level;
+
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
 
-    list_sort(&cond->waiters, decrease_sema_func, NULL);
-
-    if (!list_empty(&cond->waiters))
-        sema_up(&list_entry(list_pop_front(&cond->waiters), struct semaphore_elem, elem)->semaphore);
+    old_level = intr_disable();
+    if (!pq_empty(&cond->waiters))
+        sema_up(&cond_pop(cond)->semaphore);
+    intr_set_level(old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -407,9 +592,197 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED)
    interrupt handler. */
 void cond_broadcast(struct condition *cond, struct lock *lock)
 {
+    enum intr_level old_level;
+
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
+    ASSERT(!intr_context());
+    ASSERT(lock_held_by_current_thread(lock));
+
+    /* Wake every waiter in one batch, in priority order, and only
+       then check whether one of them should preempt us. */
+    old_level = intr_disable();
+    while (!pq_empty(&cond->waiters))
+        sema_wake(&cond_pop(cond)->semaphore);
+    intr_set_level(old_level);
+
+    run_highest_priority_thread(thread_get_priority());
+}
+
+/* Initializes RWLOCK.  A readers-writer lock may be held either
+   by any number of readers at once or by a single writer.
+
+   The writer holds RWLOCK's internal `struct lock' for as long as
+   it writes, and each reader holds it just long enough to count
+   itself in.  This gives the lock two useful properties:
+
+   - Fairness.  A writer that is waiting for readers to leave
+     already holds the internal lock, so readers that arrive after
+     it queue up behind it instead of starving it.  Waiters are
+     admitted in priority order, FIFO within a priority.
+
+   - Priority donation.  Threads waiting to read or write donate
+     their priority to the writer, or to the writer-to-be that is
+     draining the current readers, like for any other lock.  That
+     writer in turn donates to the oldest reader, through
+     `read_owner', whose holder is always the reader at the front
+     of `readers'.  When that reader leaves, the donation passes
+     to the next one, so the readers are drained one after another
+     at the writer's priority rather than whenever they would
+     otherwise get to run.  Each thread has one `read_elem', so it
+     may hold at most one rwlock for reading at a time. */
+void rwlock_init(struct rwlock *rw)
+{
+    ASSERT(rw != NULL);
+
+    lock_init(&rw->write_lock);
+    lock_init(&rw->read_owner);
+    sema_init(&rw->drained, 0);
+    list_init(&rw->readers);
+    rw->writer_waiting = false;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.  Must not be called within an interrupt
+   handler. */
+void rwlock_acquire_read(struct rwlock *rw)
+{
+    struct thread *curr = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+
+    lock_acquire(&rw->write_lock);
+    old_level = intr_disable();
+    list_push_back(&rw->readers, &curr->read_elem);
+    if (rw->read_owner.holder == NULL)
+        rw->read_owner.holder = curr;
+    intr_set_level(old_level);
+    lock_release(&rw->write_lock);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   The last reader out lets a waiting writer in. */
+void rwlock_release_read(struct rwlock *rw)
+{
+    struct thread *curr = thread_current();
+    struct pq_elem *e = &rw->read_owner.donation_elem;
+    enum intr_level old_level;
+    bool donated = false;
+    int priority = 0;
+
+    ASSERT(rw != NULL);
+
+    old_level = intr_disable();
+    ASSERT(!list_empty(&rw->readers));
+    list_remove(&curr->read_elem);
+    if (rw->read_owner.holder == curr)
+    {
+        /* Hand the writer's donation on to the next reader. */
+        donated = pq_contains(&curr->donations, e);
+        if (donated)
+        {
+            priority = e->key;
+            pq_remove(&curr->donations, e);
+            thread_refresh_priority(curr);
+        }
+        rw->read_owner.holder = list_empty(&rw->readers) ? NULL : list_entry(list_front(&rw->readers), struct thread, read_elem);
+        if (donated)
+            donate_priority(&rw->read_owner, priority);
+    }
+    if (list_empty(&rw->readers) && rw->writer_waiting)
+        sema_up(&rw->drained);
+    else if (donated)
+        run_highest_priority_thread(thread_get_priority());
+    intr_set_level(old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it in either mode.  Must not be called within an interrupt
+   handler. */
+void rwlock_acquire_write(struct rwlock *rw)
+{
+    struct thread *curr = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+
+    lock_acquire(&rw->write_lock);
+    old_level = intr_disable();
+    while (!list_empty(&rw->readers))
+    {
+        rw->writer_waiting = true;
+        if (!thread_mlfqs)
+        {
+            curr->wait_on_lock = &rw->read_owner;
+            donate_priority(&rw->read_owner, curr->priority);
+        }
+        sema_down(&rw->drained);
+        curr->wait_on_lock = NULL;
+    }
+    rw->writer_waiting = false;
+    intr_set_level(old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void rwlock_release_write(struct rwlock *rw)
+{
+    ASSERT(rwlock_held_for_write(rw));
+
+    lock_release(&rw->write_lock);
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool rwlock_held_for_write(const struct rwlock *rw)
+{
+    ASSERT(rw != NULL);
+
+    return lock_held_by_current_thread(&rw->write_lock) && rw->read_owner.holder == NULL;
+}
+
+/* Initializes SL as an unlocked spinlock. */
+void spin_lock_init(struct spinlock *sl)
+{
+    ASSERT(sl != NULL);
+
+    sl->locked = 0;
+    sl->holder = NULL;
+}
+
+/* Disables interrupts, acquires SL, and returns the previous
+   interrupt level, to be passed to spin_unlock_irqrestore().  SL
+   must not already be held by this processor.  Never sleeps,
+   so it may be called within an interrupt handler. */
+enum intr_level spin_lock_irqsave(struct spinlock *sl)
+{
+    enum intr_level old_level;
+
+    ASSERT(sl != NULL);
+
+    old_level = intr_disable();
+    ASSERT(!spin_lock_held(sl));
+    while (__atomic_exchange_n(&sl->locked, 1, __ATOMIC_ACQUIRE))
+        while (sl->locked)
+            asm volatile("pause");
+    sl->holder = this_cpu();
+    return old_level;
+}
+
+/* Releases SL, which must be held by this processor, and
+   restores the interrupt level to OLD_LEVEL. */
+void spin_unlock_irqrestore(struct spinlock *sl, enum intr_level old_level)
+{
+    ASSERT(spin_lock_held(sl));
+
+    sl->holder = NULL;
+    __atomic_store_n(&sl->locked, 0, __ATOMIC_RELEASE);
+    intr_set_level(old_level);
+}
+
+/* Returns true if this processor holds SL. */
+bool spin_lock_held(const struct spinlock *sl)
+{
+    ASSERT(sl != NULL);
 
-    while (!list_empty(&cond->waiters))
-        cond_signal(cond, lock);
+    return sl->locked && sl->holder == this_cpu();
 }
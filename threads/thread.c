@@ -6,11 +6,14 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "devices/timer.h"
 #include "intrinsic.h"
+#include "threads/fixed-point.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #ifdef USERPROG
@@ -26,9 +29,91 @@
      Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-     that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue of processes in THREAD_READY state, that is, processes
+     that are ready to run but not actually running.
+
+     There is one FIFO list per priority level.  Bit P of
+     ready_mask is set exactly when ready_queues[P] is non-empty,
+     so the highest runnable priority is found with a single
+     count-leading-zeros instead of a list walk. */
+#define READY_QUEUE_CNT (PRI_MAX + 1)
+static struct list ready_queues[READY_QUEUE_CNT];
+static uint64_t ready_mask;
+static int ready_cnt; /* # of threads in the run queue. */
+
+/* CFS run queue.
+
+     Under the completely fair scheduler, ready threads sit in a
+     red-black tree ordered by virtual runtime instead of in
+     ready_queues.  Each tick a thread runs adds
+     CFS_TICK_VRUNTIME * CFS_NICE_0_WEIGHT / weight to its
+     vruntime, where the weight follows from its nice value, so
+     CPU time is shared in proportion to weight and the leftmost
+     thread is always the one furthest behind its fair share.
+
+     cfs_min_vruntime never decreases.  It follows the smallest
+     vruntime among runnable threads and is where new and waking
+     threads are placed, so that a long sleep does not turn into
+     an equally long monopoly of the CPU. */
+static struct rb_tree cfs_tree;
+static int64_t cfs_min_vruntime;
+static int64_t cfs_load; /* Total weight of threads in cfs_tree. */
+
+#define CFS_NICE_0_WEIGHT 1024 /* Weight of a thread with nice 0. */
+#define CFS_TICK_VRUNTIME 1024 /* vruntime of one tick at nice 0. */
+#define CFS_LATENCY 8          /* Ticks in which each runnable thread should run once. */
+#define CFS_MIN_GRANULARITY 1  /* Shortest time slice, in ticks. */
+
+/* vruntime by which a woken thread must trail the running thread
+     to preempt it. */
+#define CFS_WAKEUP_GRANULARITY CFS_TICK_VRUNTIME
+
+/* How far behind cfs_min_vruntime a thread that slept may be
+     placed: half a scheduling period. */
+#define CFS_SLEEPER_CREDIT (CFS_LATENCY * CFS_TICK_VRUNTIME / 2)
+
+/* Real-time run queue.
+
+     Threads in the real-time class, set up by
+     thread_set_deadline(), always run before any other thread,
+     whatever the scheduler.  Among themselves they run earliest
+     deadline first: ready ones sit in rt_tree, ordered by the
+     absolute deadline of their current period.
+
+     Each period a thread may run for rt_runtime ticks.  Once that
+     budget is spent it is throttled, parked on rt_throttled
+     until its next period starts, so that a runaway real-time
+     thread cannot take more than it reserved.
+
+     Admission control keeps the total density, the sum of
+     runtime / deadline over all real-time threads, at or below
+     RT_BW_LIMIT.  That is enough for EDF to meet every deadline
+     and leaves the rest of the CPU to ordinary threads. */
+static struct rb_tree rt_tree;
+static struct list rt_throttled; /* Throttled threads, by `elem'. */
+static int64_t rt_total_bw;      /* Sum of `rt_bw' of all real-time threads. */
+
+#define RT_BW_UNIT (1 << 20)               /* Bandwidth of a whole CPU. */
+#define RT_BW_LIMIT (RT_BW_UNIT / 100 * 95) /* At most 95% for real time. */
+
+/* Weight of each nice value, NICE_MIN first.  Each step is about
+     1.25 times the next, so one nice level is worth roughly 10%
+     of the CPU between two competing threads. */
+static const int cfs_nice_weight[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548,  7620,  6100,  4904,  3906,
+    /*  -5 */ 3121,  2501,  1991,  1586,  1277,
+    /*   0 */ 1024,  820,   655,   526,   423,
+    /*   5 */ 335,   272,   215,   172,   137,
+    /*  10 */ 110,   87,    70,    56,    45,
+    /*  15 */ 36,    29,    23,    18,    15,
+    /*  20 */ 12,
+};
+
+/* List of all live threads, linked through `all_elem'.  Used by
+     the MLFQS scheduler's once-per-second recalculation. */
+static struct list all_list;
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -39,8 +124,6 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
-struct lock rw_lock;
-
 /* Thread destruction requests */
 static struct list destruction_req;
 
@@ -48,6 +131,8 @@ static struct list destruction_req;
 static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
+static long long thread_page_hits;   /* # of thread pages from palloc's caches. */
+static long long thread_page_misses; /* # of thread pages from the buddy system. */
 
 /* Scheduling. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
@@ -58,6 +143,14 @@ static unsigned thread_ticks; /* # 마지막 양보 이후 사용한 틱 수 */
      Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+     Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* MLFQS: system load average, estimating the number of threads
+     ready to run over the past minute. */
+static fixed_t load_avg;
+
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
@@ -66,6 +159,27 @@ static void init_thread(struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
+static void mlfqs_tick(struct thread *);
+static void mlfqs_recalculate(void);
+static void mlfqs_update_priority(struct thread *);
+static void ready_queue_push(struct thread *);
+static void ready_queue_remove(struct thread *);
+static int ready_queue_max_priority(void);
+static struct thread *ready_queue_pop(void);
+static int cfs_weight(const struct thread *);
+static bool cfs_less(const struct rb_node *, const struct rb_node *, void *aux);
+static void cfs_tick(struct thread *);
+static unsigned cfs_time_slice(struct thread *);
+static bool cfs_should_preempt(struct thread *);
+static void cfs_update_min_vruntime(struct thread *);
+static struct thread *cfs_first(void);
+static bool thread_is_rt(const struct thread *);
+static bool rt_less(const struct rb_node *, const struct rb_node *, void *aux);
+static void rt_replenish(struct thread *, int64_t start);
+static bool rt_tick(struct thread *);
+static bool rt_should_preempt(struct thread *);
+static void rt_leave(struct thread *);
+static bool thread_waiting(void);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -108,14 +222,20 @@ void thread_init(void)
 
     /* Init the globla thread context */
     lock_init(&tid_lock);
-    list_init(&ready_list);
+    for (int i = 0; i < READY_QUEUE_CNT; i++)
+        list_init(&ready_queues[i]);
+    ready_mask = 0;
+    ready_cnt = 0;
+    rb_init(&cfs_tree, cfs_less, NULL);
+    cfs_min_vruntime = 0;
+    cfs_load = 0;
+    rb_init(&rt_tree, rt_less, NULL);
+    list_init(&rt_throttled);
+    rt_total_bw = 0;
+    list_init(&all_list);
+    load_avg = 0;
     list_init(&destruction_req);
 
-    /* sleep list initialize */
-    list_init(&sleep_list);
-
-    lock_init(&rw_lock);
-
     /* Set up a thread structure for the running thread. */
     initial_thread = running_thread();
     init_thread(initial_thread, "main", PRI_DEFAULT);
@@ -155,18 +275,35 @@ void thread_tick(void)
     else
         kernel_ticks++;
 
-    /* Enforce preemption. */
-    /* 양보하고나서의 시간 >= 타임 슬라이스 */
+    if (thread_mlfqs)
+        mlfqs_tick(t);
+    else if (thread_cfs && !thread_is_rt(t))
+        cfs_tick(t);
 
+    /* Enforce preemption.  Real-time threads are not time-sliced:
+         they run until they block, use up their budget, or a thread
+         with an earlier deadline becomes ready. */
+    /* 양보하고나서의 시간 >= 타임 슬라이스 */
+    if (rt_tick(t))
+        intr_yield_on_return();
     // RR 방식( 우선순위 스케줄링에서는 필요 없음 )
-    if (++thread_ticks >= TIME_SLICE)
+    else if (!thread_is_rt(t) && ++thread_ticks >= (thread_cfs ? cfs_time_slice(t) : TIME_SLICE))
         intr_yield_on_return();
 }
 
+/* Accounts for SKIPPED timer ticks that elapsed without a timer
+     interrupt because the idle thread had stopped the periodic
+     tick.  See timer_idle_enter(). */
+void thread_account_idle(int64_t skipped)
+{
+    idle_ticks += skipped;
+}
+
 /* Prints thread statistics. */
 void thread_print_stats(void)
 {
     printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n", idle_ticks, kernel_ticks, user_ticks);
+    printf("Thread pages: %lld cache hits, %lld misses\n", thread_page_hits, thread_page_misses);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -194,19 +331,44 @@ thread_start()가 호출되었다면, 새로운 스레드는 thread_create()가
 tid_t thread_create(const char *name, int priority, thread_func *function, void *aux)
 {
     struct thread *t;
+    bool cached;
     tid_t tid;
 
     ASSERT(function != NULL);
 
-    /* Allocate thread. */
-    t = palloc_get_page(PAL_ZERO);
+    /* Allocate thread.  No need for PAL_ZERO: init_thread() clears
+         the `struct thread' header, and the kernel stack above it
+         needs no initialization.  Dead threads' pages go back to
+         palloc's per-processor magazines, so this usually reuses
+         one of them. */
+    t = palloc_get_page_cached(0, &cached);
     if (t == NULL)
         return TID_ERROR;
+    if (cached)
+        thread_page_hits++;
+    else
+        thread_page_misses++;
 
     /* Initialize thread. */
     init_thread(t, name, priority);
     tid = t->tid = allocate_tid();
 
+    /* Under MLFQS the PRIORITY argument is ignored: the new thread
+     * inherits its parent's nice and recent_cpu values and its
+     * priority follows from them. */
+    if (thread_mlfqs)
+    {
+        t->nice = thread_current()->nice;
+        t->recent_cpu = thread_current()->recent_cpu;
+        mlfqs_update_priority(t);
+    }
+
+    /* Under CFS the new thread starts at the smallest vruntime, so
+     * it neither jumps ahead of the threads that are already
+     * runnable nor waits for all of them to catch up. */
+    if (thread_cfs)
+        t->vruntime = cfs_min_vruntime;
+
     /* Call the kernel_thread if it scheduled.
      * Note) rdi is 1st argument, and rsi is 2nd argument. */
     t->tf.rip = (uintptr_t)kernel_thread;
@@ -218,13 +380,8 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
     t->tf.cs = SEL_KCSEG;
     t->tf.eflags = FLAG_IF;
 
-    /* file descriptor */
-    t->fdt = palloc_get_page(PAL_ZERO);
-    if (t->fdt == NULL)
-    {
-        // PANIC("Failed to allocate file descriptor table");
-        return TID_ERROR;
-    }
+    /* file descriptor.  The table itself is allocated on first
+     * use, see process_add_file(). */
     t->next_fd = 3;
 
     /* for systemcall */
@@ -261,14 +418,6 @@ void thread_block(void)
      it may expect that it can atomically unblock a thread and
      update other data. */
 
-bool decrease_func(const struct list_elem *a, const struct list_elem *b, void *aux)
-{
-    struct thread *thread_a = list_entry(a, struct thread, elem);
-    struct thread *thread_b = list_entry(b, struct thread, elem);
-
-    return thread_a->priority > thread_b->priority;
-}
-
 void thread_unblock(struct thread *t)
 {
     enum intr_level old_level;
@@ -277,10 +426,33 @@ void thread_unblock(struct thread *t)
 
     old_level = intr_disable();
     ASSERT(t->status == THREAD_BLOCKED);
-    list_insert_ordered(&ready_list, &t->elem, decrease_func, NULL);
+
+    /* A thread that slept is owed at most CFS_SLEEPER_CREDIT, not
+         all the CPU time it would have used while asleep. */
+    if (thread_cfs && t->vruntime < cfs_min_vruntime - CFS_SLEEPER_CREDIT)
+        t->vruntime = cfs_min_vruntime - CFS_SLEEPER_CREDIT;
+
+    /* A real-time thread that wakes up keeps its deadline only if
+         its remaining budget still fits before the deadline at its
+         reserved rate.  Otherwise running it under that deadline
+         could push other threads past theirs, so it starts a new
+         period now. */
+    if (thread_is_rt(t))
+    {
+        int64_t now = timer_ticks();
+
+        if (now >= t->rt_abs_deadline || t->rt_budget * t->rt_deadline > (t->rt_abs_deadline - now) * t->rt_runtime)
+            rt_replenish(t, now);
+    }
+    ready_queue_push(t);
+
+    /* A real-time thread preempts right away when woken from an
+         interrupt handler.  Otherwise we leave it to the caller; see
+         the comment above. */
+    if (intr_context() && rt_should_preempt(thread_current()))
+        intr_yield_on_return();
     t->status = THREAD_READY;
 
-    // list_push_back(&ready_list, &t->elem);
     intr_set_level(old_level);
 }
 
@@ -327,6 +499,8 @@ void thread_exit(void)
     /* Just set our status to dying and schedule another process.
          We will be destroyed during the call to schedule_tail(). */
     intr_disable();
+    rt_leave(thread_current());
+    list_remove(&thread_current()->all_elem);
     /* for systemcall */
 
     sema_up(&thread_current()->wait_sema);
@@ -347,88 +521,491 @@ void thread_yield(void)
     ASSERT(!intr_context());
     old_level = intr_disable();
     if (curr != idle_thread)
+        ready_queue_push(curr);
+    do_schedule(THREAD_READY);
+    intr_set_level(old_level);
+}
+
+/* Sets the current thread's priority to NEW_PRIORITY. */
+void thread_set_priority(int new_priority)
+{
+    /* The MLFQS scheduler computes priorities itself. */
+    if (thread_mlfqs)
+        return;
+
+    thread_current()->prev_priority = new_priority;
+    thread_refresh_priority(thread_current());
+    run_highest_priority_thread(thread_get_priority());
+}
+
+/* Yields if a ready thread should run instead of the current
+     one, whose priority is CURR_PRIORITY.  Under CFS, that is if
+     the leftmost thread has fallen far enough behind instead. */
+void run_highest_priority_thread(int curr_priority)
+{
+    struct thread *cur = thread_current();
+    bool yield;
+
+    /* Interrupt handlers cannot yield, and neither can a thread
+         already being switched out inside schedule(), which picks
+         the next thread itself. */
+    if (intr_context() || cur->status != THREAD_RUNNING)
+        return;
+    if (rt_should_preempt(cur))
+        yield = true;
+    else if (thread_is_rt(cur))
+        yield = false;
+    else
+        yield = thread_cfs ? cfs_should_preempt(cur) : ready_queue_max_priority() > curr_priority;
+    if (yield)
+        thread_yield();
+}
+
+/* Changes T's effective priority to PRIORITY.  If T is sitting
+     in the run queue it is moved to the queue of its new priority,
+     which keeps next_thread_to_run() correct after a donation
+     without re-sorting anything.  Likewise, if T is waiting on a
+     semaphore or condition variable, its position in that wait
+     queue is updated. */
+void thread_set_effective_priority(struct thread *t, int priority)
+{
+    enum intr_level old_level;
+
+    ASSERT(is_thread(t));
+    ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+    old_level = intr_disable();
+    if (t->status == THREAD_READY && t->priority != priority)
     {
-        // list_push_back(&ready_list, &curr->elem);
-        list_insert_ordered(&ready_list, &curr->elem, decrease_func, NULL);
+        ready_queue_remove(t);
+        t->priority = priority;
+        ready_queue_push(t);
     }
-    do_schedule(THREAD_READY);
+    else
+        t->priority = priority;
+
+    if (t->wait_queue != NULL)
+        pq_update(t->wait_queue, &t->wait_elem, priority);
+    if (t->cond_queue != NULL)
+        pq_update(t->cond_queue, t->cond_elem, priority);
+    intr_set_level(old_level);
+}
+
+/* Recomputes T's effective priority as the larger of its own
+     priority and the highest priority donated through any lock it
+     holds.  O(1): the donations are kept in a heap (see synch.c). */
+void thread_refresh_priority(struct thread *t)
+{
+    int priority = t->prev_priority;
+
+    if (!pq_empty(&t->donations) && pq_top(&t->donations)->key > priority)
+        priority = pq_top(&t->donations)->key;
+    thread_set_effective_priority(t, priority);
+}
+
+/* Returns the current thread's priority. */
+int thread_get_priority(void)
+{
+    return thread_current()->priority;
+}
+
+/* Sets the current thread's nice value to NICE and recomputes
+     its priority or CFS weight, yielding if it should no longer
+     run. */
+void thread_set_nice(int nice)
+{
+    enum intr_level old_level;
+
+    ASSERT(NICE_MIN <= nice && nice <= NICE_MAX);
+
+    old_level = intr_disable();
+    thread_current()->nice = nice;
+    if (thread_mlfqs)
+        mlfqs_update_priority(thread_current());
     intr_set_level(old_level);
+
+    run_highest_priority_thread(thread_get_priority());
 }
 
-void donate_priority_2(struct lock *lock)
+/* Moves the current thread into the real-time class.  From now
+     on, in every PERIOD ticks, starting now, it may run for up to
+     RUNTIME ticks ahead of all ordinary threads, and is scheduled
+     so as to have done so within DEADLINE ticks of the period's
+     start.  Real-time threads are scheduled earliest deadline
+     first.
+
+     Requires 0 < RUNTIME <= DEADLINE <= PERIOD.  Returns false,
+     leaving the thread's class unchanged, if the parameters are
+     out of range or the reservation would overcommit the CPU.  A
+     real-time thread may call this again to change its
+     reservation. */
+bool thread_set_deadline(int64_t runtime, int64_t deadline, int64_t period)
 {
+    struct thread *cur = thread_current();
     enum intr_level old_level;
+    int64_t bw;
+
+    if (runtime <= 0 || runtime > deadline || deadline > period)
+        return false;
+    bw = runtime * RT_BW_UNIT / deadline;
+
     old_level = intr_disable();
-    if (lock->holder->priority < thread_current()->priority)
+    if (rt_total_bw - cur->rt_bw + bw > RT_BW_LIMIT)
     {
-        list_insert_ordered(&(lock->holder->donation_list), &(thread_current()->donation_elem), decrease_func, NULL);
-        while (true)
-        {
-            lock->holder->priority = thread_current()->priority;
-            if (lock->holder->wait_on_lock == NULL)
-                return;
-            lock = lock->holder->wait_on_lock;
-        }
+        intr_set_level(old_level);
+        return false;
     }
+    rt_total_bw += bw - cur->rt_bw;
+    cur->rt_runtime = runtime;
+    cur->rt_deadline = deadline;
+    cur->rt_period = period;
+    cur->rt_bw = bw;
+    rt_replenish(cur, timer_ticks());
     intr_set_level(old_level);
+
+    run_highest_priority_thread(thread_get_priority());
+    return true;
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
-void thread_set_priority(int new_priority)
+/* Returns the current thread to the ordinary scheduling class,
+     releasing its reservation. */
+void thread_clear_deadline(void)
 {
-    if (thread_current()->priority == thread_current()->prev_priority)
-        thread_current()->priority = new_priority;
-    thread_current()->prev_priority = new_priority;
-    if (thread_current()->wait_on_lock != NULL)
-        donate_priority_2(thread_current()->wait_on_lock);
+    enum intr_level old_level = intr_disable();
+    rt_leave(thread_current());
+    intr_set_level(old_level);
+
     run_highest_priority_thread(thread_get_priority());
 }
 
-void run_highest_priority_thread(int curr_priority)
+/* Called by a real-time thread when it has finished its work for
+     the current period: gives up the rest of its budget and waits
+     for the next period to start. */
+void thread_yield_deadline(void)
 {
-    if (list_empty(&ready_list))
-        return;
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int64_t now;
 
-    struct list_elem *front = list_begin(&ready_list);
-    struct thread *front_t = list_entry(front, struct thread, elem);
+    ASSERT(thread_is_rt(cur));
 
-    if (!intr_context() && front_t->priority > curr_priority)
+    old_level = intr_disable();
+    now = timer_ticks();
+    if (now >= cur->rt_next_period)
+        rt_replenish(cur, now);
+    else
     {
-        thread_yield();
+        cur->rt_budget = 0;
+        cur->rt_throttled = true;
     }
+    thread_yield();
+    intr_set_level(old_level);
 }
 
-/* Returns the current thread's priority. */
-int thread_get_priority(void)
+/* Returns the tick by which the current thread, which must be a
+     real-time thread, has to finish its work for the current
+     period. */
+int64_t thread_get_deadline(void)
 {
-    return thread_current()->priority;
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int64_t deadline;
+
+    ASSERT(thread_is_rt(cur));
+
+    old_level = intr_disable();
+    deadline = cur->rt_abs_deadline;
+    intr_set_level(old_level);
+    return deadline;
 }
 
-/* Sets the current thread's nice value to NICE. */
-void thread_set_nice(int nice UNUSED)
+/* Returns the tick at which the next throttled real-time thread
+     gets its budget back, or INT64_MAX if none is throttled.  Lets
+     the tickless idle loop wake up in time. */
+int64_t thread_next_replenish(void)
 {
-    /* TODO: Your implementation goes here */
+    int64_t next = INT64_MAX;
+    struct list_elem *e;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    for (e = list_begin(&rt_throttled); e != list_end(&rt_throttled); e = list_next(e))
+    {
+        struct thread *t = list_entry(e, struct thread, elem);
+
+        if (t->rt_next_period < next)
+            next = t->rt_next_period;
+    }
+    return next;
 }
 
 /* Returns the current thread's nice value. */
 int thread_get_nice(void)
 {
-    /* TODO: Your implementation goes here */
-    return 0;
+    return thread_current()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int thread_get_load_avg(void)
 {
-    /* TODO: Your implementation goes here */
-    return 0;
+    enum intr_level old_level = intr_disable();
+    int result = fp_round(fp_mul_int(load_avg, 100));
+    intr_set_level(old_level);
+    return result;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu(void)
 {
-    /* TODO: Your implementation goes here */
-    return 0;
+    enum intr_level old_level = intr_disable();
+    int result = fp_round(fp_mul_int(thread_current()->recent_cpu, 100));
+    intr_set_level(old_level);
+    return result;
+}
+
+/* MLFQS bookkeeping for one timer tick, with CUR running.
+
+     Only the running thread's recent_cpu changes from tick to
+     tick, so only its priority is refreshed every fourth tick.
+     Everything else is brought up to date by a single pass over
+     all threads once per second. */
+static void mlfqs_tick(struct thread *cur)
+{
+    int64_t now = timer_ticks();
+
+    if (cur != idle_thread)
+        cur->recent_cpu = fp_add_int(cur->recent_cpu, 1);
+
+    if (now % TIMER_FREQ == 0)
+        mlfqs_recalculate();
+    else if (now % TIME_SLICE == 0 && cur != idle_thread)
+        mlfqs_update_priority(cur);
+    else
+        return;
+
+    if (ready_queue_max_priority() > cur->priority)
+        intr_yield_on_return();
+}
+
+/* Once-per-second MLFQS pass: updates the load average, decays
+     every thread's recent_cpu and recomputes every priority. */
+static void mlfqs_recalculate(void)
+{
+    int ready_threads = ready_cnt;
+    fixed_t decay;
+    struct list_elem *e;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (thread_current() != idle_thread)
+        ready_threads++;
+    load_avg = fp_add(fp_mul(fp_div_int(fp_from_int(59), 60), load_avg),
+                      fp_mul_int(fp_div_int(fp_from_int(1), 60), ready_threads));
+
+    /* The decay factor is the same for every thread. */
+    decay = fp_div(fp_mul_int(load_avg, 2), fp_add_int(fp_mul_int(load_avg, 2), 1));
+
+    for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+    {
+        struct thread *t = list_entry(e, struct thread, all_elem);
+
+        if (t == idle_thread)
+            continue;
+        t->recent_cpu = fp_add_int(fp_mul(decay, t->recent_cpu), t->nice);
+        mlfqs_update_priority(t);
+    }
+}
+
+/* Recomputes T's MLFQS priority from its recent_cpu and nice
+     values, moving it between run queues if necessary. */
+static void mlfqs_update_priority(struct thread *t)
+{
+    int priority = PRI_MAX - fp_to_int(fp_div_int(t->recent_cpu, 4)) - t->nice * 2;
+
+    if (priority > PRI_MAX)
+        priority = PRI_MAX;
+    else if (priority < PRI_MIN)
+        priority = PRI_MIN;
+    thread_set_effective_priority(t, priority);
+}
+
+/* Returns T's CFS weight. */
+static int cfs_weight(const struct thread *t)
+{
+    return cfs_nice_weight[t->nice - NICE_MIN];
+}
+
+/* Orders the CFS run queue by vruntime.  Threads with equal
+     vruntime stay in the order in which they became ready. */
+static bool cfs_less(const struct rb_node *a_, const struct rb_node *b_, void *aux UNUSED)
+{
+    const struct thread *a = rb_entry(a_, struct thread, cfs_node);
+    const struct thread *b = rb_entry(b_, struct thread, cfs_node);
+
+    return a->vruntime < b->vruntime;
+}
+
+/* Returns the thread with the smallest vruntime in the CFS run
+     queue, or a null pointer if it is empty. */
+static struct thread *cfs_first(void)
+{
+    struct rb_node *n = rb_first(&cfs_tree);
+
+    return n != NULL ? rb_entry(n, struct thread, cfs_node) : NULL;
+}
+
+/* Advances cfs_min_vruntime to the smallest vruntime among CUR,
+     which is running or about to run, and the threads in the run
+     queue. */
+static void cfs_update_min_vruntime(struct thread *cur)
+{
+    struct thread *first = cfs_first();
+    int64_t min = INT64_MAX;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (cur != idle_thread)
+        min = cur->vruntime;
+    if (first != NULL && first->vruntime < min)
+        min = first->vruntime;
+    if (min != INT64_MAX && min > cfs_min_vruntime)
+        cfs_min_vruntime = min;
+}
+
+/* CFS bookkeeping for one timer tick, with CUR running: charges
+     the tick to CUR's vruntime, scaled by its weight. */
+static void cfs_tick(struct thread *cur)
+{
+    if (cur != idle_thread)
+        cur->vruntime += CFS_TICK_VRUNTIME * CFS_NICE_0_WEIGHT / cfs_weight(cur);
+    cfs_update_min_vruntime(cur);
+}
+
+/* Returns CUR's time slice in ticks: its weighted share of a
+     scheduling period of CFS_LATENCY ticks, stretched when there
+     are so many runnable threads that slices would drop below
+     CFS_MIN_GRANULARITY. */
+static unsigned cfs_time_slice(struct thread *cur)
+{
+    int64_t nr_running = ready_cnt + 1;
+    int64_t period = CFS_LATENCY;
+    int64_t weight = cfs_weight(cur);
+    int64_t slice;
+
+    if (nr_running * CFS_MIN_GRANULARITY > period)
+        period = nr_running * CFS_MIN_GRANULARITY;
+    slice = period * weight / (cfs_load + weight);
+    return slice > CFS_MIN_GRANULARITY ? slice : CFS_MIN_GRANULARITY;
+}
+
+/* Returns true if CUR should give way to the leftmost thread in
+     the CFS run queue.  The idle thread always does; any other
+     thread only if the leftmost one trails it by more than
+     CFS_WAKEUP_GRANULARITY, so that wakeups do not force a switch
+     over every small difference. */
+static bool cfs_should_preempt(struct thread *cur)
+{
+    enum intr_level old_level = intr_disable();
+    struct thread *first = cfs_first();
+    bool preempt = first != NULL
+                   && (cur == idle_thread || cur->vruntime - first->vruntime > CFS_WAKEUP_GRANULARITY);
+
+    intr_set_level(old_level);
+    return preempt;
+}
+
+/* Returns true if T is in the real-time class. */
+static bool thread_is_rt(const struct thread *t)
+{
+    return t->rt_runtime != 0;
+}
+
+/* Orders the real-time run queue by absolute deadline.  Threads
+     with equal deadlines stay in the order in which they became
+     ready. */
+static bool rt_less(const struct rb_node *a_, const struct rb_node *b_, void *aux UNUSED)
+{
+    const struct thread *a = rb_entry(a_, struct thread, rt_node);
+    const struct thread *b = rb_entry(b_, struct thread, rt_node);
+
+    return a->rt_abs_deadline < b->rt_abs_deadline;
+}
+
+/* Returns the ready real-time thread with the earliest deadline,
+     or a null pointer if there is none. */
+static struct thread *rt_first(void)
+{
+    struct rb_node *n = rb_first(&rt_tree);
+
+    return n != NULL ? rb_entry(n, struct thread, rt_node) : NULL;
+}
+
+/* Starts a new period for real-time thread T at tick START, with
+     a full budget. */
+static void rt_replenish(struct thread *t, int64_t start)
+{
+    t->rt_abs_deadline = start + t->rt_deadline;
+    t->rt_next_period = start + t->rt_period;
+    t->rt_budget = t->rt_runtime;
+    t->rt_throttled = false;
+}
+
+/* Real-time bookkeeping for one timer tick, with CUR running.
+     Gives throttled threads whose next period has come their
+     budget back and charges the tick to CUR if it is a real-time
+     thread.  Returns true if CUR should yield. */
+static bool rt_tick(struct thread *cur)
+{
+    int64_t now = timer_ticks();
+    struct list_elem *e;
+
+    for (e = list_begin(&rt_throttled); e != list_end(&rt_throttled);)
+    {
+        struct thread *t = list_entry(e, struct thread, elem);
+
+        e = list_next(e);
+        if (now >= t->rt_next_period)
+        {
+            /* Periods that went by entirely while throttled are
+                 lost, rather than owed. */
+            list_remove(&t->elem);
+            rt_replenish(t, t->rt_next_period + t->rt_period <= now ? now : t->rt_next_period);
+            rb_insert(&rt_tree, &t->rt_node);
+        }
+    }
+
+    if (thread_is_rt(cur) && --cur->rt_budget <= 0)
+    {
+        cur->rt_throttled = true;
+        return true;
+    }
+    return rt_should_preempt(cur);
+}
+
+/* Returns true if a ready real-time thread should run instead of
+     CUR: always if CUR is an ordinary thread, otherwise only if
+     its deadline is earlier. */
+static bool rt_should_preempt(struct thread *cur)
+{
+    enum intr_level old_level = intr_disable();
+    struct thread *first = rt_first();
+    bool preempt = first != NULL && (!thread_is_rt(cur) || first->rt_abs_deadline < cur->rt_abs_deadline);
+
+    intr_set_level(old_level);
+    return preempt;
+}
+
+/* Takes T, which is running, out of the real-time class. */
+static void rt_leave(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!thread_is_rt(t))
+        return;
+    rt_total_bw -= t->rt_bw;
+    t->rt_runtime = t->rt_deadline = t->rt_period = t->rt_bw = 0;
+    t->rt_throttled = false;
+    t->vruntime = cfs_min_vruntime;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -449,10 +1026,25 @@ static void idle(void *idle_started_ UNUSED)
 
     for (;;)
     {
-        /* Let someone else run. */
+        /* Let someone else run.  schedule() resumes periodic
+             ticking before switching away from us. */
         intr_disable();
         thread_block();
 
+        /* Nothing else is runnable, so zero free pages for later
+             PAL_ZERO requests until something is, or there is
+             nothing left to zero. */
+        intr_enable();
+        while (!thread_waiting() && palloc_prezero())
+            continue;
+        intr_disable();
+        if (thread_waiting())
+            continue;
+
+        /* Nothing else is runnable, so in tickless mode there is no
+             need for a timer interrupt before the next wakeup. */
+        timer_idle_enter();
+
         /* Re-enable interrupts and wait for the next one.
 
              The `sti' instruction disables interrupts until the
@@ -483,6 +1075,8 @@ static void kernel_thread(thread_func *function, void *aux)
      NAME. */
 static void init_thread(struct thread *t, const char *name, int priority)
 { // 커널이 자기 자신을 쓰레드로 만드는 작업
+    enum intr_level old_level;
+
     ASSERT(t != NULL);
     ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
     ASSERT(name != NULL);
@@ -493,8 +1087,7 @@ static void init_thread(struct thread *t, const char *name, int priority)
     t->tf.rsp = (uint64_t)t + PGSIZE - sizeof(void *); //	스택포인터 저장
     t->priority = priority;
     t->prev_priority = priority;
-    /* donation list initialize */
-    list_init(&(t->donation_list));
+    pq_init(&t->donations);
 
     /* child list initialize */
     list_init(&(t->child_list));
@@ -504,6 +1097,12 @@ static void init_thread(struct thread *t, const char *name, int priority)
     sema_init(&t->exit_sema, 0);
     sema_init(&t->fork_sema, 0);
 
+    t->nice = NICE_DEFAULT;
+    t->recent_cpu = 0;
+    old_level = intr_disable();
+    list_push_back(&all_list, &t->all_elem);
+    intr_set_level(old_level);
+
     t->magic = THREAD_MAGIC; // 매직을 넘으면 스택을 넘은 것 . 스택의 마지막을 매직으로 설정해서 스택 오버플로우를 감지한다.
 }
 
@@ -514,13 +1113,117 @@ static void init_thread(struct thread *t, const char *name, int priority)
      idle_thread. */
 static struct thread *next_thread_to_run(void)
 {
-    if (list_empty(&ready_list))
+    struct thread *rt = rt_first();
+
+    if (rt != NULL)
+    {
+        rb_remove(&rt_tree, &rt->rt_node);
+        return rt;
+    }
+    if (ready_cnt == 0)
         return idle_thread;
     else
-    { /* 후 순위 쓰레드가 도네이션을 받아 우선순위 상승했을 때를 고려 */
-        list_sort(&ready_list, decrease_func, NULL);
-        return list_entry(list_pop_front(&ready_list), struct thread, elem);
+        return ready_queue_pop();
+}
+
+/* Returns true if a thread other than the running one is ready
+     to run. */
+static bool thread_waiting(void)
+{
+    return ready_cnt > 0 || rt_first() != NULL;
+}
+
+/* Appends T to the back of the run queue for its priority, or
+     under CFS inserts it into the tree by vruntime.  Real-time
+     threads go to the real-time run queue instead, or to
+     rt_throttled if they have no budget left. */
+static void ready_queue_push(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (thread_is_rt(t))
+    {
+        if (t->rt_throttled)
+            list_push_back(&rt_throttled, &t->elem);
+        else
+            rb_insert(&rt_tree, &t->rt_node);
+        return;
+    }
+    if (thread_cfs)
+    {
+        rb_insert(&cfs_tree, &t->cfs_node);
+        cfs_load += cfs_weight(t);
+    }
+    else
+    {
+        list_push_back(&ready_queues[t->priority], &t->elem);
+        ready_mask |= (uint64_t)1 << t->priority;
+    }
+    ready_cnt++;
+}
+
+/* Removes T from the run queue. */
+static void ready_queue_remove(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (thread_is_rt(t))
+    {
+        if (t->rt_throttled)
+            list_remove(&t->elem);
+        else
+            rb_remove(&rt_tree, &t->rt_node);
+        return;
+    }
+    if (thread_cfs)
+    {
+        rb_remove(&cfs_tree, &t->cfs_node);
+        cfs_load -= cfs_weight(t);
+    }
+    else
+    {
+        list_remove(&t->elem);
+        if (list_empty(&ready_queues[t->priority]))
+            ready_mask &= ~((uint64_t)1 << t->priority);
     }
+    ready_cnt--;
+}
+
+/* Returns the highest priority among ready threads, or -1 if no
+     thread is ready.  Not meaningful under CFS. */
+static int ready_queue_max_priority(void)
+{
+    uint64_t mask = ready_mask;
+
+    if (mask == 0)
+        return -1;
+    return 63 - __builtin_clzll(mask);
+}
+
+/* Removes and returns the thread that has waited longest at the
+     highest ready priority, or under CFS the thread with the
+     smallest vruntime.  The run queue must not be empty. */
+static struct thread *ready_queue_pop(void)
+{
+    int pri;
+    struct thread *t;
+
+    if (thread_cfs)
+    {
+        t = cfs_first();
+        ASSERT(t != NULL);
+        ready_queue_remove(t);
+        cfs_update_min_vruntime(t);
+        return t;
+    }
+
+    pri = ready_queue_max_priority();
+    ASSERT(pri >= 0);
+    t = list_entry(list_pop_front(&ready_queues[pri]), struct thread, elem);
+    if (list_empty(&ready_queues[pri]))
+        ready_mask &= ~((uint64_t)1 << pri);
+    ready_cnt--;
+    return t;
 }
 
 /* Use iretq to launch the thread */
@@ -553,74 +1256,29 @@ void do_iret(struct intr_frame *tf)
         : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-     tables, and, if the previous thread is dying, destroying it.
+/* Switches from the running thread to TH.
 
-     At this function's invocation, we just switched from thread
-     PREV, the new thread is already running, and interrupts are
-     still disabled.
+     At this function's invocation, TH's page tables are already
+     active and interrupts are still disabled.  The running thread
+     is always suspended inside schedule(), in kernel mode, so only
+     its callee-saved registers and stack pointer are kept, on its
+     own stack (see switch.S).  TH is resumed the same way, unless
+     it has never run, in which case it starts from the interrupt
+     frame set up by thread_create() through do_iret().
 
-     It's not safe to call printf() until the thread switch is
-     complete.  In practice that means that printf()s should be
-     added at the end of the function. */
+     Returning to user mode does not go through here: the full
+     register set of a user thread stays in the interrupt frame on
+     its kernel stack and is restored by intr_exit. */
 static void thread_launch(struct thread *th)
 {
-    uint64_t tf_cur = (uint64_t)&running_thread()->tf;
-    uint64_t tf = (uint64_t)&th->tf;
+    struct thread *curr = running_thread();
+
     ASSERT(intr_get_level() == INTR_OFF);
 
-    /* The main switching logic.
-     * We first restore the whole execution context into the intr_frame
-     * and then switching to the next thread by calling do_iret.
-     * Note that, we SHOULD NOT use any stack from here
-     * until switching is done. */
-    __asm __volatile(
-        /* Store registers that will be used. */
-        "push %%rax\n"
-        "push %%rbx\n"
-        "push %%rcx\n"
-        /* Fetch input once */
-        "movq %0, %%rax\n"
-        "movq %1, %%rcx\n"
-        "movq %%r15, 0(%%rax)\n"
-        "movq %%r14, 8(%%rax)\n"
-        "movq %%r13, 16(%%rax)\n"
-        "movq %%r12, 24(%%rax)\n"
-        "movq %%r11, 32(%%rax)\n"
-        "movq %%r10, 40(%%rax)\n"
-        "movq %%r9, 48(%%rax)\n"
-        "movq %%r8, 56(%%rax)\n"
-        "movq %%rsi, 64(%%rax)\n"
-        "movq %%rdi, 72(%%rax)\n"
-        "movq %%rbp, 80(%%rax)\n"
-        "movq %%rdx, 88(%%rax)\n"
-        "pop %%rbx\n" // Saved rcx
-        "movq %%rbx, 96(%%rax)\n"
-        "pop %%rbx\n" // Saved rbx
-        "movq %%rbx, 104(%%rax)\n"
-        "pop %%rbx\n" // Saved rax
-        "movq %%rbx, 112(%%rax)\n"
-        "addq $120, %%rax\n"
-        "movw %%es, (%%rax)\n"
-        "movw %%ds, 8(%%rax)\n"
-        "addq $32, %%rax\n"
-        "call __next\n" // read the current rip.
-        "__next:\n"
-        "pop %%rbx\n"
-        "addq $(out_iret -  __next), %%rbx\n"
-        "movq %%rbx, 0(%%rax)\n" // rip
-        "movw %%cs, 8(%%rax)\n"  // cs
-        "pushfq\n"
-        "popq %%rbx\n"
-        "mov %%rbx, 16(%%rax)\n" // eflags
-        "mov %%rsp, 24(%%rax)\n" // rsp
-        "movw %%ss, 32(%%rax)\n"
-        "mov %%rcx, %%rdi\n"
-        "call do_iret\n"
-        "out_iret:\n"
-        :
-        : "g"(tf_cur), "g"(tf)
-        : "memory");
+    if (th->switch_rsp != 0)
+        thread_switch(&curr->switch_rsp, th->switch_rsp);
+    else
+        thread_switch_frame(&curr->switch_rsp, &th->tf);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -644,11 +1302,24 @@ static void do_schedule(int status)
 static void schedule(void)
 {
     struct thread *curr = running_thread();
-    struct thread *next = next_thread_to_run();
+    struct thread *next;
 
     ASSERT(intr_get_level() == INTR_OFF);
     ASSERT(curr->status != THREAD_RUNNING);
+
+    /* Leave tickless idle before anything else runs, however the
+         idle thread came to be switched out: through its own loop,
+         or by an interrupt handler that woke a thread and asked to
+         yield on return.  Otherwise the new thread would run
+         without a periodic tick until the one-shot fired, and those
+         ticks would all be booked as idle.  Catching up may wake
+         sleepers and workers, so do it before choosing who runs. */
+    if (curr == idle_thread)
+        timer_idle_exit();
+
+    next = next_thread_to_run();
     ASSERT(is_thread(next));
+
     /* Mark us as running. */
     next->status = THREAD_RUNNING;
 
@@ -0,0 +1,385 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of worker threads.  More than one, so that an item that
+     sleeps, say on disk I/O, does not hold up the rest. */
+#define WORKER_CNT 2
+
+/* A worker thread and the item it is running. */
+struct worker
+{
+    struct thread *thread; /* The worker thread. */
+    struct work *running;  /* Item being run, or null. */
+    uint64_t seq;          /* `seq' of `running'. */
+    bool requeue;          /* Run `running' again when it returns? */
+};
+
+/* A thread waiting in flush_until(). */
+struct flusher
+{
+    struct list_elem elem;  /* Element in `flushers'. */
+    uint64_t target;        /* Waits for all items before this seq. */
+    struct semaphore done;  /* Up'd when they have all run. */
+};
+
+/* Workqueue state.  Work may be queued from interrupt handlers, so
+     all of this is accessed with interrupts off. */
+static struct worker workers[WORKER_CNT];
+static struct list pending_list;      /* Queued items, by `elem'. */
+static struct semaphore pending_sema; /* Up'd once per queued item. */
+static struct list timer_list;        /* Delayed work, soonest first. */
+static struct list flushers;          /* Threads in flush_until(). */
+static uint64_t next_seq;             /* Next `seq' to hand out. */
+
+/* Statistics. */
+static long long queued_cnt; /* # of items queued. */
+static long long run_cnt;    /* # of items run. */
+
+static thread_func worker_main NO_RETURN;
+static uint64_t oldest_in_flight(void);
+static void wake_flushers(void);
+static void flush_until(uint64_t target);
+
+/* Initializes the workqueue.  Must be called before the timer
+     interrupt is enabled, as that drives delayed work.  Items may
+     be queued from then on, but they do not run until
+     workqueue_start(). */
+void workqueue_init(void)
+{
+    list_init(&pending_list);
+    sema_init(&pending_sema, 0);
+    list_init(&timer_list);
+    list_init(&flushers);
+    next_seq = 0;
+}
+
+/* Starts the worker threads.  Must be called after
+     thread_start(). */
+void workqueue_start(void)
+{
+    int i;
+
+    for (i = 0; i < WORKER_CNT; i++)
+    {
+        char name[16];
+
+        snprintf(name, sizeof name, "kworker/%d", i);
+        if (thread_create(name, PRI_DEFAULT, worker_main, &workers[i]) == TID_ERROR)
+            PANIC("cannot start %s", name);
+    }
+}
+
+/* Prints workqueue statistics. */
+void workqueue_print_stats(void)
+{
+    printf("Workqueue: %lld items queued, %lld run\n", queued_cnt, run_cnt);
+}
+
+/* Initializes W to call FUNC when it runs. */
+void work_init(struct work *w, work_func *func)
+{
+    ASSERT(w != NULL);
+    ASSERT(func != NULL);
+
+    w->func = func;
+    w->pending = false;
+    w->seq = 0;
+}
+
+/* Initializes DW to call FUNC when it runs. */
+void delayed_work_init(struct delayed_work *dw, work_func *func)
+{
+    work_init(&dw->work, func);
+    dw->expires = 0;
+    dw->timer_pending = false;
+}
+
+/* Queues W to be run by a worker thread.  Returns false, doing
+     nothing, if W is already pending.  May be called from an
+     interrupt handler. */
+bool queue_work(struct work *w)
+{
+    enum intr_level old_level;
+    int i;
+
+    ASSERT(w != NULL);
+
+    old_level = intr_disable();
+    if (w->pending)
+    {
+        intr_set_level(old_level);
+        return false;
+    }
+    w->pending = true;
+    w->seq = next_seq++;
+    queued_cnt++;
+
+    /* If W is running, the worker running it takes it up again
+         when it returns, so that W never runs twice at once. */
+    for (i = 0; i < WORKER_CNT; i++)
+        if (workers[i].running == w)
+        {
+            workers[i].requeue = true;
+            intr_set_level(old_level);
+            return true;
+        }
+
+    list_push_back(&pending_list, &w->elem);
+    sema_up(&pending_sema);
+    intr_set_level(old_level);
+    return true;
+}
+
+/* Returns true if delayed work A expires before B. */
+static bool expires_before(const struct list_elem *a_, const struct list_elem *b_, void *aux UNUSED)
+{
+    const struct delayed_work *a = list_entry(a_, struct delayed_work, timer_elem);
+    const struct delayed_work *b = list_entry(b_, struct delayed_work, timer_elem);
+
+    return a->expires < b->expires;
+}
+
+/* Queues DW's work item once TICKS timer ticks have passed, or
+     right away if TICKS is not positive.  Returns false, doing
+     nothing, if DW is already waiting for its timer or pending.
+     May be called from an interrupt handler. */
+bool queue_delayed_work(struct delayed_work *dw, int64_t ticks)
+{
+    enum intr_level old_level;
+
+    ASSERT(dw != NULL);
+
+    if (ticks <= 0)
+        return queue_work(&dw->work);
+
+    old_level = intr_disable();
+    if (dw->timer_pending || dw->work.pending)
+    {
+        intr_set_level(old_level);
+        return false;
+    }
+    dw->expires = timer_ticks() + ticks;
+    dw->timer_pending = true;
+    list_insert_ordered(&timer_list, &dw->timer_elem, expires_before, NULL);
+    intr_set_level(old_level);
+    return true;
+}
+
+/* Stops DW from running if it is waiting for its timer or
+     pending.  Returns true if it was.  Does not wait for DW if it
+     is already running; use flush_work() for that. */
+bool cancel_delayed_work(struct delayed_work *dw)
+{
+    enum intr_level old_level;
+    bool cancelled = false;
+    int i;
+
+    ASSERT(dw != NULL);
+
+    old_level = intr_disable();
+    if (dw->timer_pending)
+    {
+        list_remove(&dw->timer_elem);
+        dw->timer_pending = false;
+        cancelled = true;
+    }
+    else if (dw->work.pending)
+    {
+        /* Either in the pending list or due to be requeued by the
+             worker running it.  A worker woken for it finds the
+             pending list shorter than expected, which it allows
+             for. */
+        for (i = 0; i < WORKER_CNT; i++)
+            if (workers[i].running == &dw->work)
+                break;
+        if (i < WORKER_CNT)
+            workers[i].requeue = false;
+        else
+            list_remove(&dw->work.elem);
+        dw->work.pending = false;
+        cancelled = true;
+        wake_flushers();
+    }
+    intr_set_level(old_level);
+    return cancelled;
+}
+
+/* Waits until W, if it is pending or running, has run, along
+     with all work queued before it.  Delayed work still waiting
+     for its timer is not waited for.  Must not be called from a
+     work item. */
+void flush_work(struct work *w)
+{
+    enum intr_level old_level;
+    uint64_t target = 0;
+    int i;
+
+    ASSERT(w != NULL);
+
+    old_level = intr_disable();
+    if (w->pending)
+        target = w->seq + 1;
+    for (i = 0; i < WORKER_CNT; i++)
+        if (workers[i].running == w && workers[i].seq + 1 > target)
+            target = workers[i].seq + 1;
+    if (target != 0)
+        flush_until(target);
+    intr_set_level(old_level);
+}
+
+/* Waits until all work queued so far has run.  Must not be called
+     from a work item. */
+void flush_workqueue(void)
+{
+    enum intr_level old_level = intr_disable();
+    flush_until(next_seq);
+    intr_set_level(old_level);
+}
+
+/* Queues the delayed work whose timers have expired as of tick
+     NOW.  Called from the timer interrupt handler. */
+void workqueue_timer_tick(int64_t now)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (!list_empty(&timer_list))
+    {
+        struct delayed_work *dw = list_entry(list_front(&timer_list), struct delayed_work, timer_elem);
+
+        if (dw->expires > now)
+            break;
+        list_pop_front(&timer_list);
+        dw->timer_pending = false;
+        queue_work(&dw->work);
+    }
+}
+
+/* Returns the tick at which the next delayed work expires, or
+     INT64_MAX if there is none.  Lets the tickless idle loop wake
+     up in time. */
+int64_t workqueue_next_expiry(void)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (list_empty(&timer_list))
+        return INT64_MAX;
+    return list_entry(list_front(&timer_list), struct delayed_work, timer_elem)->expires;
+}
+
+/* Worker thread: runs queued work items, oldest first. */
+static void worker_main(void *worker_)
+{
+    struct worker *worker = worker_;
+
+    worker->thread = thread_current();
+    for (;;)
+    {
+        struct work *w;
+
+        sema_down(&pending_sema);
+
+        intr_disable();
+        if (list_empty(&pending_list))
+        {
+            /* The item we were woken for was cancelled. */
+            intr_enable();
+            continue;
+        }
+        w = list_entry(list_pop_front(&pending_list), struct work, elem);
+        w->pending = false;
+        worker->running = w;
+        worker->seq = w->seq;
+        worker->requeue = false;
+        intr_enable();
+
+        w->func(w);
+
+        /* W may have been freed by its function, so it is touched
+             again only if it was queued in the meantime. */
+        intr_disable();
+        run_cnt++;
+        worker->running = NULL;
+        if (worker->requeue)
+        {
+            list_push_back(&pending_list, &w->elem);
+            sema_up(&pending_sema);
+        }
+        wake_flushers();
+        intr_enable();
+    }
+}
+
+/* Returns the smallest `seq' among pending and running items, or
+     UINT64_MAX if there are none.  An item queued again while it
+     runs is covered by the older `seq' of the run in progress
+     until it goes back on the pending list, after items queued in
+     the meantime, so the list is not sorted and has to be
+     scanned. */
+static uint64_t oldest_in_flight(void)
+{
+    uint64_t oldest = UINT64_MAX;
+    struct list_elem *e;
+    int i;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    for (e = list_begin(&pending_list); e != list_end(&pending_list); e = list_next(e))
+    {
+        struct work *w = list_entry(e, struct work, elem);
+
+        if (w->seq < oldest)
+            oldest = w->seq;
+    }
+    for (i = 0; i < WORKER_CNT; i++)
+        if (workers[i].running != NULL && workers[i].seq < oldest)
+            oldest = workers[i].seq;
+    return oldest;
+}
+
+/* Wakes the flushers whose items have all run. */
+static void wake_flushers(void)
+{
+    struct list_elem *e;
+    uint64_t oldest;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (list_empty(&flushers))
+        return;
+    oldest = oldest_in_flight();
+    for (e = list_begin(&flushers); e != list_end(&flushers);)
+    {
+        struct flusher *f = list_entry(e, struct flusher, elem);
+
+        e = list_next(e);
+        if (f->target <= oldest)
+        {
+            list_remove(&f->elem);
+            sema_up(&f->done);
+        }
+    }
+}
+
+/* Waits until every item with a `seq' below TARGET has run. */
+static void flush_until(uint64_t target)
+{
+    struct flusher f;
+    int i;
+
+    ASSERT(!intr_context());
+    ASSERT(intr_get_level() == INTR_OFF);
+    for (i = 0; i < WORKER_CNT; i++)
+        ASSERT(workers[i].thread != thread_current());
+
+    if (oldest_in_flight() >= target)
+        return;
+    f.target = target;
+    sema_init(&f.done, 0);
+    list_push_back(&flushers, &f.elem);
+    sema_down(&f.done);
+}
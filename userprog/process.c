@@ -13,6 +13,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -103,7 +104,7 @@ tid_t process_fork(const char *name, struct intr_frame *if_ UNUSED)
 
 #ifndef VM
 /* Duplicate the parent's address space by passing this function to the
- * pml4_for_each. This is only for the project 2. */
+ * pml4_for_each_range. This is only for the project 2. */
 static bool
 duplicate_pte(uint64_t *pte, void *va, void *aux)
 {
@@ -182,7 +183,8 @@ __do_fork(void *aux)
 	if (!supplemental_page_table_copy(&current->spt, &parent->spt))
 		goto error;
 #else
-	if (!pml4_for_each(parent->pml4, duplicate_pte, parent))
+	/* Only user pages need copying; the kernel's are shared. */
+	if (!pml4_for_each_range(parent->pml4, NULL, (void *)KERN_BASE, duplicate_pte, parent))
 	{
 		goto error;
 	}
@@ -196,29 +198,15 @@ __do_fork(void *aux)
 
 	// 넣어줘야하는건 parent 가 열어고있는 파일목록을 복사하는게 맞는거같음
 	// 리턴값이 파일포인터니까
-	int cnt = 3;
-	struct file **table = parent->fdt;
-	while (cnt < parent->next_fd)
+	if (parent->fdt_size > 0 && !process_fdt_reserve(current, parent->fdt_size - 1))
+		goto error;
+	for (int cnt = 3; cnt < parent->next_fd; cnt++)
 	{
-		if (table[cnt])
-		{
-			struct file *d_file = file_duplicate(table[cnt]);
-			if (!d_file)
-			{
-				current->fdt[cnt] = NULL;
-				current->next_fd++;
-				continue;
-			}
-			current->fdt[cnt] = d_file;
-			current->next_fd++;
-		}
-		else
-		{
-			current->fdt[cnt] = NULL;
-			current->next_fd++;
-		}
-		cnt++;
+		struct file *p_file = parent->fdt[cnt];
+
+		current->fdt[cnt] = p_file != NULL ? file_duplicate(p_file) : NULL;
 	}
+	current->next_fd = parent->next_fd;
 
 	// process_init();
 
@@ -315,14 +303,16 @@ void process_exit(void)
 	}
 
 
-	for (int c_fd = 0; c_fd < curr->next_fd; c_fd++)
+	for (int c_fd = 0; c_fd < curr->fdt_size; c_fd++)
 	{
 		if (curr->fdt[c_fd] != NULL)
 			process_close_file(c_fd);
 	}
 	file_close(curr->run_file);
 
-	palloc_free_page(curr->fdt);
+	free(curr->fdt);
+	curr->fdt = NULL;
+	curr->fdt_size = 0;
 
 	process_cleanup();
 }
@@ -751,25 +741,65 @@ install_page(void *upage, void *kpage, bool writable)
 }
 
 /* file descriptor */
+
+/* Initial number of slots in a file descriptor table. */
+#define FDT_INIT_SIZE 16
+
+/* Makes sure T's file descriptor table has a slot for FD,
+ * allocating or doubling it as needed.  New slots are null.
+ * Most processes open only a few files, so the table starts
+ * small instead of taking a whole page.
+ * Returns false if memory allocation fails. */
+bool process_fdt_reserve(struct thread *t, int fd)
+{
+	int size = t->fdt_size > 0 ? t->fdt_size : FDT_INIT_SIZE;
+	struct file **fdt;
+
+	if (fd < t->fdt_size)
+		return true;
+	while (size <= fd)
+		size *= 2;
+
+	fdt = realloc(t->fdt, size * sizeof *fdt);
+	if (fdt == NULL)
+		return false;
+	memset(fdt + t->fdt_size, 0, (size - t->fdt_size) * sizeof *fdt);
+	t->fdt = fdt;
+	t->fdt_size = size;
+	return true;
+}
+
+/* Installs F at the current thread's next file descriptor and
+ * returns it, or returns -1 if memory allocation fails. */
 int process_add_file(struct file *f)
 {
 	struct thread *t = thread_current();
 
+	if (!process_fdt_reserve(t, t->next_fd))
+		return -1;
 	t->fdt[t->next_fd] = f;
 
 	return t->next_fd++;
 }
 
+/* Returns the file open as FD in the current thread, or a null
+ * pointer if there is none. */
 struct file *process_get_file(int fd)
 {
-	return thread_current()->fdt[fd];
+	struct thread *t = thread_current();
+
+	if (fd < 0 || fd >= t->fdt_size)
+		return NULL;
+	return t->fdt[fd];
 }
 
 void process_close_file(int fd)
 {
+	struct file *f = process_get_file(fd);
 
-	file_close(process_get_file(fd));
-
+	if (f == NULL)
+		return;
+	file_close(f);
 	thread_current()->fdt[fd] = NULL;
 }
 
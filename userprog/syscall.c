@@ -36,7 +36,6 @@ void close(int);
 int exec(const char *);
 int wait(tid_t);
 
-// struct lock *rw_lock;
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -179,23 +178,15 @@ int open(const char *file)
 	if (file == NULL || !check_address(file))
 		exit(-1);
 
-	// lock_acquire(&rw_lock);
 	struct file *open_file = filesys_open(file);
-	// lock_release(&rw_lock);
 
 	if (open_file == NULL)
 		return -1;
-	struct thread *t = thread_current();
-	struct file **table = t->fdt;
-	int fd = t->next_fd;
-	if (fd >= MAX_OPEN_FILE)
-	{
-		free(open_file);
-		return -1;
-	}
-
-	table[fd] = open_file;
-	t->next_fd = fd + 1;
+	int fd = -1;
+	if (thread_current()->next_fd < MAX_OPEN_FILE)
+		fd = process_add_file(open_file);
+	if (fd == -1)
+		file_close(open_file);
 	return fd;
 }
 
@@ -212,7 +203,6 @@ int read(int fd, void *buffer, unsigned size)
 
 	if (fd == 0)
 	{
-		// lock_release(&rw_lock);
 		unsigned i;
 		for (i = 0; i < size; i++)
 		{
@@ -224,22 +214,15 @@ int read(int fd, void *buffer, unsigned size)
 	f = process_get_file(fd);
 
 	if (f == NULL || fd >= MAX_OPEN_FILE)
-	{
-		//	lock_release(&rw_lock);
 		return -1;
-	}
-	else
-	{
-		lock_acquire(&rw_lock);
-		off_t ret = file_read(f, buffer, size);
-		lock_release(&rw_lock);
-		return ret;
-	}
+
+	/* The inode serializes against writers; readers of the same
+	   or other files proceed in parallel. */
+	return file_read(f, buffer, size);
 }
 
 int write(int fd, void *buffer, unsigned size)
 {
-	// lock_acquire(&rw_lock);
 	struct file *f;
 
 	if (fd == 1)
@@ -251,17 +234,9 @@ int write(int fd, void *buffer, unsigned size)
 	f = process_get_file(fd);
 
 	if (f == NULL || fd >= MAX_OPEN_FILE)
-	{
-		// lock_release(&rw_lock);
 		return -1;
-	}
-	else
-	{
-		lock_acquire(&rw_lock);
-		off_t ret = file_write(f, buffer, size);
-		lock_release(&rw_lock);
-		return ret;
-	}
+
+	return file_write(f, buffer, size);
 }
 
 void seek(int fd, unsigned position)